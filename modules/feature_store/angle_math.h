@@ -0,0 +1,81 @@
+#ifndef ANGLE_MATH_H
+#define ANGLE_MATH_H
+#include <math.h>
+#include "feature_store.h"
+
+/**
+ * 方位角、仰角的无分支实现，供Feature_Store与批量特征引擎共用
+ * 象限与零值判定全部以选择代替分支：先用安全分母求主值 atan(y/x)，
+ * 再按符号加上 3000/6000 密位偏移，最后用EPSILON判定覆盖坐标轴上的取值，
+ * 与原先的分支写法逐位一致（包括1500/3000/4500/6000密位常数与RADTOMIL）
+ * 循环体内没有数据相关的分支，批量路径可按通道向量化
+ */
+
+// 角度主值的计算方式
+enum AngleMode
+{
+    ANGLE_EXACT = 0,  // 调用libm的atan，与原实现逐位一致
+    ANGLE_FAST = 1    // 多项式近似，可完全向量化，最大绝对误差 ANGLE_FAST_MAX_ERROR 弧度
+};
+
+// 快速模式主值的最大绝对误差（弧度），约合1e-5密位
+#define ANGLE_FAST_MAX_ERROR 1e-8
+
+/**
+ * atan(y/x) 主值的多项式近似，要求 x 非零
+ * 以 min(|x|,|y|)/max(|x|,|y|) 归约到[0,1]，在该区间用17阶奇多项式（切比雪夫插值）逼近，
+ * |y|>|x| 时取 pi/2 减去主值，最后恢复符号
+ */
+inline double fast_atan_ratio(double y, double x)
+{
+    double ax = fabs(x);
+    double ay = fabs(y);
+    double r = (ay > ax ? ax : ay) / (ay > ax ? ay : ax);
+    double s = r * r;
+    double p = 0.0027662835283182277;
+    p = p * s - 0.015731249223588546;
+    p = p * s + 0.04213762374570251;
+    p = p * s - 0.07456854838521723;
+    p = p * s + 0.10618370642479312;
+    p = p * s - 0.14197797795407988;
+    p = p * s + 0.19991872029264307;
+    p = p * s - 0.3333303670929285;
+    p = p * s + 0.9999999817886557;
+    p = p * r;
+    double complement = M_PI_2 - p;
+    p = ay > ax ? complement : p;
+    // x*y 与 y/x 同号（含下溢为带符号零的情况）
+    return copysign(p, x * y);
+}
+
+/**
+ * 方位角（弧度），取值与约定同 Feature_Store::CalAzimuth
+ */
+inline double branchless_azimuth(double x, double y, bool fast)
+{
+    // |v| < EPSILON 与原写法 (v < EPSILON) && (v > -EPSILON) 等价
+    double x_safe = fabs(x) < EPSILON ? 1.0 : x;
+    double principal = fast ? fast_atan_ratio(y, x_safe) : atan(y / x_safe);
+    double offset = x > 0.0 ? (y > 0.0 ? 0.0 : 6000.0/RADTOMIL) : 3000.0/RADTOMIL;
+    double result = principal + offset;
+    double on_x_axis = x > 0.0 ? 0.0 : 3000.0/RADTOMIL;
+    double on_y_axis = y > 0.0 ? 1500.0/RADTOMIL : 4500.0/RADTOMIL;
+    double on_axis = fabs(x) < EPSILON ? on_y_axis : on_x_axis;
+    double origin = fabs(y) < EPSILON ? 0.0 : on_axis;
+    result = fabs(y) < EPSILON ? on_x_axis : result;
+    return fabs(x) < EPSILON ? origin : result;
+}
+
+/**
+ * 仰角（弧度），取值与约定同 Feature_Store::CalElevation
+ */
+inline double branchless_elevation(double x, double y, double h, bool fast)
+{
+    double R = sqrt(x * x + y * y);
+    double r_safe = R < EPSILON ? 1.0 : R;
+    double principal = fast ? fast_atan_ratio(h, r_safe) : atan(h / r_safe);
+    double pole = h > EPSILON ? 1500.0/RADTOMIL : -1500.0/RADTOMIL;
+    pole = fabs(h) < EPSILON ? 0.0 : pole;
+    return R < EPSILON ? pole : principal;
+}
+#endif
@@ -0,0 +1,253 @@
+#include "batch_feature_engine.h"
+#include <algorithm>
+#include <cstring>
+#include <math.h>
+
+// x86-64 GCC下为向量化内核生成多个指令集版本，由加载器按CPU选择
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__)
+#define ML_TARGET_CLONES __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+#define ML_TARGET_CLONES
+#endif
+
+// 禁止把乘加收缩为FMA，否则支持FMA的版本与Feature_Store的结果不再逐位一致；
+// 写在源码中，不依赖构建系统给本文件加的编译选项
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+namespace {
+
+// 输入分量在SoA中的起始平面
+enum InputPlane
+{
+    IN_X_TARGET = 0,
+    IN_V_TARGET = 3,
+    IN_A_TARGET = 6,
+    IN_STDV = 9,
+    IN_MEANV = 12,
+    IN_STDA = 15,
+    IN_MEANA = 18,
+    IN_FILTER_V = 21,
+    IN_FILTER_A = 24
+};
+
+inline double modu(double x, double y, double z)
+{
+    return sqrt(x*x+y*y+z*z);
+}
+
+inline double cross_modu(double vx, double vy, double vz, double ax, double ay, double az)
+{
+    return modu(vy*az-vz*ay, vz*ax-vx*az, vx*ay-vy*ax);
+}
+
+/**
+ * 曲率与相似度特征（输出21~30），每次迭代处理一个目标，循环无分支可按通道向量化
+ * in/out 为 [维度, stride] 的平面
+ */
+ML_TARGET_CLONES
+void compute_vector_features(const double* __restrict in, double* __restrict out, int n, int stride)
+{
+    const double* fvx = in + (IN_FILTER_V+0)*stride;
+    const double* fvy = in + (IN_FILTER_V+1)*stride;
+    const double* fvz = in + (IN_FILTER_V+2)*stride;
+    const double* fax = in + (IN_FILTER_A+0)*stride;
+    const double* fay = in + (IN_FILTER_A+1)*stride;
+    const double* faz = in + (IN_FILTER_A+2)*stride;
+    const double* svx = in + (IN_STDV+0)*stride;
+    const double* svy = in + (IN_STDV+1)*stride;
+    const double* svz = in + (IN_STDV+2)*stride;
+    const double* mvx = in + (IN_MEANV+0)*stride;
+    const double* mvy = in + (IN_MEANV+1)*stride;
+    const double* mvz = in + (IN_MEANV+2)*stride;
+    const double* sax = in + (IN_STDA+0)*stride;
+    const double* say = in + (IN_STDA+1)*stride;
+    const double* saz = in + (IN_STDA+2)*stride;
+    const double* max_ = in + (IN_MEANA+0)*stride;
+    const double* may = in + (IN_MEANA+1)*stride;
+    const double* maz = in + (IN_MEANA+2)*stride;
+    double* curv_fva = out + 21*stride;
+    double* curv_mva = out + 22*stride;
+    double* curv_sva = out + 23*stride;
+    double* curv_svma = out + 24*stride;
+    double* curv_mvsa = out + 25*stride;
+    double* sim_fva = out + 26*stride;
+    double* sim_mva = out + 27*stride;
+    double* sim_sva = out + 28*stride;
+    double* sim_svma = out + 29*stride;
+    double* sim_mvsa = out + 30*stride;
+
+    // 曲率分母与单目标内核一样用pow计算，先暂存在曲率输出平面中；
+    // pow不能向量化，单独成一个循环，不影响下面的主循环
+    for (int i = 0; i < n; i++)
+    {
+        curv_fva[i] = pow(modu(fvx[i], fvy[i], fvz[i]), 3.0)+EPSILON;
+        curv_mva[i] = pow(modu(mvx[i], mvy[i], mvz[i]), 3.0)+EPSILON;
+        curv_sva[i] = pow(modu(svx[i], svy[i], svz[i]), 3.0)+EPSILON;
+    }
+
+    // 各平面互不重叠，告知编译器无需插入运行时别名检查
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC ivdep
+#endif
+    for (int i = 0; i < n; i++)
+    {
+        double mod_fv = modu(fvx[i], fvy[i], fvz[i]);
+        double mod_fa = modu(fax[i], fay[i], faz[i]);
+        double mod_mv = modu(mvx[i], mvy[i], mvz[i]);
+        double mod_ma = modu(max_[i], may[i], maz[i]);
+        double mod_sv = modu(svx[i], svy[i], svz[i]);
+        double mod_sa = modu(sax[i], say[i], saz[i]);
+        double cube_fv = curv_fva[i];
+        double cube_mv = curv_mva[i];
+        double cube_sv = curv_sva[i];
+
+        curv_fva[i] = cross_modu(fvx[i], fvy[i], fvz[i], fax[i], fay[i], faz[i])/cube_fv;
+        curv_mva[i] = cross_modu(mvx[i], mvy[i], mvz[i], max_[i], may[i], maz[i])/cube_mv;
+        curv_sva[i] = cross_modu(svx[i], svy[i], svz[i], sax[i], say[i], saz[i])/cube_sv;
+        curv_svma[i] = cross_modu(svx[i], svy[i], svz[i], max_[i], may[i], maz[i])/cube_sv;
+        curv_mvsa[i] = cross_modu(mvx[i], mvy[i], mvz[i], sax[i], say[i], saz[i])/cube_mv;
+
+        sim_fva[i] = (fvx[i]*fax[i]+fvy[i]*fay[i]+fvz[i]*faz[i])/(mod_fv+EPSILON)/(mod_fa+EPSILON);
+        sim_mva[i] = (mvx[i]*max_[i]+mvy[i]*may[i]+mvz[i]*maz[i])/(mod_mv+EPSILON)/(mod_ma+EPSILON);
+        sim_sva[i] = (svx[i]*sax[i]+svy[i]*say[i]+svz[i]*saz[i])/(mod_sv+EPSILON)/(mod_sa+EPSILON);
+        sim_svma[i] = (svx[i]*max_[i]+svy[i]*may[i]+svz[i]*maz[i])/(mod_sv+EPSILON)/(mod_ma+EPSILON);
+        sim_mvsa[i] = (mvx[i]*sax[i]+mvy[i]*say[i]+mvz[i]*saz[i])/(mod_mv+EPSILON)/(mod_sa+EPSILON);
+    }
+}
+
+/**
+ * 方位角与仰角特征（输出31~36），fast为常量时内联展开，
+ * 快速模式下整个循环可按通道向量化，精确模式仍逐个调用atan但不再有分支
+ */
+inline void angle_features(const double* __restrict in, double* __restrict out, int n, int stride, bool fast)
+{
+    const int sources[3] = {IN_X_TARGET, IN_V_TARGET, IN_A_TARGET};
+    for (int k = 0; k < 3; k++)
+    {
+        const double* x = in + (sources[k]+0)*stride;
+        const double* y = in + (sources[k]+1)*stride;
+        const double* z = in + (sources[k]+2)*stride;
+        double* azimuth = out + (31+k)*stride;
+        double* elevation = out + (34+k)*stride;
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC ivdep
+#endif
+        for (int i = 0; i < n; i++)
+        {
+            azimuth[i] = branchless_azimuth(x[i], y[i], fast);
+            elevation[i] = branchless_elevation(x[i], y[i], z[i], fast);
+        }
+    }
+}
+
+ML_TARGET_CLONES
+void compute_angle_features_fast(const double* __restrict in, double* __restrict out, int n, int stride)
+{
+    angle_features(in, out, n, stride, true);
+}
+
+void compute_angle_features_exact(const double* __restrict in, double* __restrict out, int n, int stride)
+{
+    angle_features(in, out, n, stride, false);
+}
+
+}  // namespace
+
+BatchFeatureEngine::BatchFeatureEngine(int initial_capacity, AngleMode angle_mode)
+    : angle_mode(angle_mode)
+{
+    this->reserve(std::max(1, initial_capacity));
+}
+
+void BatchFeatureEngine::reserve(int new_capacity)
+{
+    // 每个分量平面按新容量重新排布
+    std::vector<double> new_inputs(static_cast<std::size_t>(BATCH_INPUT_DIM) * new_capacity);
+    for (int k = 0; k < BATCH_INPUT_DIM; k++)
+    {
+        std::copy(
+            this->inputs.begin() + static_cast<std::size_t>(k) * this->capacity,
+            this->inputs.begin() + static_cast<std::size_t>(k) * this->capacity + this->count,
+            new_inputs.begin() + static_cast<std::size_t>(k) * new_capacity
+        );
+    }
+    this->inputs.swap(new_inputs);
+    this->outputs.resize(static_cast<std::size_t>(TRACE_FEATURE_DIM) * new_capacity);
+    this->capacity = new_capacity;
+}
+
+void BatchFeatureEngine::clear()
+{
+    this->count = 0;
+}
+
+int BatchFeatureEngine::add(const TraceFeatureInput& input)
+{
+    if (this->count == this->capacity)
+    {
+        this->reserve(this->capacity * 2);
+    }
+    const Vec3* blocks[9] = {
+        &input.x_target, &input.v_target, &input.a_target,
+        &input.stdv, &input.meanv, &input.stda, &input.meana,
+        &input.filter_v, &input.filter_a
+    };
+    double* plane = this->inputs.data();
+    for (int b = 0; b < 9; b++)
+    {
+        for (int j = 0; j < 3; j++)
+        {
+            plane[static_cast<std::size_t>(b*3+j) * this->capacity + this->count] = (*blocks[b])[j];
+        }
+    }
+    return this->count++;
+}
+
+void BatchFeatureEngine::compute(double* features)
+{
+    const int n = this->count;
+    const int stride = this->capacity;
+    const double* in = this->inputs.data();
+    double* out = this->outputs.data();
+
+    // 前21维（目标系向量与平滑统计）与输入平面一一对应
+    std::memcpy(out, in, sizeof(double) * 21 * static_cast<std::size_t>(stride));
+    compute_vector_features(in, out, n, stride);
+    if (this->angle_mode == ANGLE_FAST)
+    {
+        compute_angle_features_fast(in, out, n, stride);
+    }
+    else
+    {
+        compute_angle_features_exact(in, out, n, stride);
+    }
+
+    // SoA -> 每个目标一行
+    for (int k = 0; k < TRACE_FEATURE_DIM; k++)
+    {
+        const double* plane = out + static_cast<std::size_t>(k) * stride;
+        for (int i = 0; i < n; i++)
+        {
+            features[static_cast<std::size_t>(i) * TRACE_FEATURE_DIM + k] = plane[i];
+        }
+    }
+}
+
+const char* BatchFeatureEngine::simd_path()
+{
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__)
+    if (__builtin_cpu_supports("avx512f"))
+    {
+        return "avx512f";
+    }
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return "avx2";
+    }
+#endif
+    return "scalar";
+}
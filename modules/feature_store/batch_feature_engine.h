@@ -0,0 +1,57 @@
+#ifndef BATCH_FEATURE_ENGINE_H
+#define BATCH_FEATURE_ENGINE_H
+#include <vector>
+#include "feature_store.h"
+#include "angle_math.h"
+
+// TraceFeatureInput 展开后的分量个数（9个三维向量）
+#define BATCH_INPUT_DIM 27
+
+/**
+ * 多目标批量航迹特征计算引擎
+ * 以结构数组(SoA)保存一批目标的特征输入，每个分量一条连续数组，
+ * 一次调用计算全部目标的37维特征，主循环沿目标方向向量化（每个SIMD通道一个目标）
+ * x86-64上通过target_clones在运行时选择AVX-512/AVX2/标量实现
+ * ANGLE_EXACT模式下结果与Feature_Store::compute_trace_features逐位一致；ANGLE_FAST模式下
+ * 方位角、仰角有不超过ANGLE_FAST_MAX_ERROR弧度的误差，此时角度部分同样可以向量化
+ */
+class BatchFeatureEngine
+{
+  private:
+    std::vector<double> inputs;    // [BATCH_INPUT_DIM, capacity]
+    std::vector<double> outputs;   // [TRACE_FEATURE_DIM, capacity]
+    int count = 0;
+    int capacity = 0;
+    AngleMode angle_mode;
+
+    void reserve(int new_capacity);
+
+  public:
+    explicit BatchFeatureEngine(int initial_capacity = 64, AngleMode angle_mode = ANGLE_EXACT);
+
+    void set_angle_mode(AngleMode mode) { angle_mode = mode; }
+    AngleMode get_angle_mode() const { return angle_mode; }
+
+    // 清空当前批次，保留已分配的存储
+    void clear();
+
+    /**
+     * 加入一个目标的特征输入
+     * @return 该目标在批次中的通道序号
+     */
+    int add(const TraceFeatureInput& input);
+
+    int size() const { return count; }
+
+    /**
+     * 计算批次内全部目标的特征
+     * @param features 输出 [size(), TRACE_FEATURE_DIM]，行优先
+     */
+    void compute(double* features);
+
+    /**
+     * 当前CPU上实际使用的SIMD路径，"avx512f"、"avx2"或"scalar"
+     */
+    static const char* simd_path();
+};
+#endif
@@ -20,23 +20,44 @@ BatchVector::~BatchVector(void)
     this-> clock_step = 0;
 }
 
+int BatchVector::physical_row(int index) const
+{
+    return (this->head + index) % this->length;
+}
+
 bool BatchVector::is_initialized()
 {
     return this->initialized;
 }
 
+int BatchVector::size() const
+{
+    return this->length;
+}
+
 xt::xarray<double> BatchVector::data()
 {
-    return  this->cache_data;
+    std::vector<int>  shape = {this->length,3};
+    xt::xarray<double> ordered = xt::empty<double>(shape);
+    const double* src = this->cache_data.data();
+    double* dst = ordered.data();
+    for (int i = 0; i < this->length; i++)
+    {
+        const double* row = src + this->physical_row(i)*3;
+        dst[i*3] = row[0];
+        dst[i*3+1] = row[1];
+        dst[i*3+2] = row[2];
+    }
+    return ordered;
 }
-xt::xarray<double> BatchVector::row_element(int index)
+RowView BatchVector::row_element(int index) const
 {
-    return  xt::row(this->cache_data,index);
+    return  RowView(this->cache_data.data() + this->physical_row(index)*3);
 }
     
-xt::xarray<double> BatchVector::col_element(int index)
+ColView BatchVector::col_element(int index) const
 {
-    return xt::col(this->cache_data,index);
+    return ColView{this->cache_data.data() + index, this->length, this->head, 3};
 }
 
 void BatchVector::update(double x,double y,double z)
@@ -47,20 +68,14 @@ void BatchVector::update(double x,double y,double z)
     {
         this->initialized = true;
     }
-    auto old_data_part = xt::view(this->cache_data,xt::range(0,this->length-1),xt::all());
-    auto new_part = xt::xarray<double>({x,y,z});
-    xt::view(this->cache_data,xt::range(1,this->length),xt::all()) = old_data_part;
-    xt::view(this->cache_data,0,xt::all()) = new_part;
+    // head前移一位，覆盖最旧的一行
+    this->head = (this->head + this->length - 1) % this->length;
+    double* row = this->cache_data.data() + this->head*3;
+    row[0] = x;
+    row[1] = y;
+    row[2] = z;
 }
-void BatchVector::update(xt::xarray<double> new_vector)
+void BatchVector::update(RowView new_vector)
 {
-    // first element is the latest element 
-    this->clock_step = this->clock_step +1;
-    if (this->clock_step > this->length)
-    {
-        this->initialized = true;
-    }
-    auto old_data_part = xt::view(this->cache_data,xt::range(0,this->length-1),xt::all());
-    xt::view(this->cache_data,xt::range(1,this->length),xt::all()) = old_data_part;
-    xt::view(this->cache_data,0,xt::all()) = new_vector;
-}
\ No newline at end of file
+    this->update(new_vector[0],new_vector[1],new_vector[2]);
+}
@@ -4,27 +4,160 @@
 #include <xtensor/xarray.hpp>
 #include <xtensor/xbuilder.hpp>
 #include <xtensor/xeval.hpp>
+#include <xtensor/xfixed.hpp>
 #include <xtensor/xio.hpp>
 #include <xtensor/xrandom.hpp>
 #include <math.h>
 
+/**
+ * 三维行向量的只读视图，指向连续存放的3个double，不持有数据
+ * 可由BatchVector行、Vec3或一维xarray隐式构造
+ */
+struct RowView
+{
+    const double* ptr;
+    RowView(const double* data) : ptr(data) {}
+    RowView(const xt::xarray<double>& row_vector) : ptr(row_vector.data()) {}
+    double operator[](std::size_t index) const { return ptr[index]; }
+};
 
+/**
+ * 栈上的三维向量，用于向量运算的返回值
+ */
+struct Vec3
+{
+    double v[3] = {0.0, 0.0, 0.0};
+    Vec3() = default;
+    Vec3(double x, double y, double z) : v{x, y, z} {}
+    double operator[](std::size_t index) const { return v[index]; }
+    double& operator[](std::size_t index) { return v[index]; }
+    operator RowView() const { return RowView(v); }
+};
+
+/**
+ * 环形缓存中某一列的跨步视图，按从新到旧的顺序访问
+ */
+struct ColView
+{
+    const double* base;   // 该列在第0个物理行中的地址
+    int length;
+    int head;
+    int stride;           // 相邻物理行之间的double个数
+    double operator[](int index) const { return base[((head + index) % length) * stride]; }
+    int size() const { return length; }
+};
+
+/**
+ * 定长环形缓存，每行为一个三维向量
+ * 更新只写入一行并移动head，开销与length无关
+ * row_element(0) 始终为最新元素，row_element(i) 为第i新的元素
+ * row_element/col_element 返回指向缓存的视图，下一次update后失效
+ */
 class BatchVector
 {
   private:
-    xt::xarray<double> cache_data;
+    xt::xarray<double> cache_data;   // 物理存储 [length,3]，按环形顺序排列
     bool initialized = false;
     int length = 0;
+    int head = 0;                    // 最新元素所在的物理行
+    int physical_row(int index) const;
   public:
     int clock_step = 0;
     BatchVector();
     BatchVector(int length);
     ~BatchVector(void);
     bool is_initialized();
+    int size() const;
+    // 按从新到旧的顺序拷贝出 [length,3] 矩阵
     xt::xarray<double> data();
-    xt::xarray<double> row_element(int index);
-    xt::xarray<double> col_element(int index);
+    RowView row_element(int index) const;
+    ColView col_element(int index) const;
     void update(double x,double y,double z);
-    void update(xt::xarray<double> new_vector);
+    void update(RowView new_vector);
+};
+
+/**
+ * 编译期定长的环形缓存，语义与BatchVector一致
+ * 存储为 xtensor_fixed，无堆分配，可直接作为成员嵌入其他对象
+ * 仅适用于构建时已知缓存长度的配置，运行时长度请使用BatchVector
+ */
+template <std::size_t N>
+class FixedBatchVector
+{
+  public:
+    using row_type = xt::xtensor_fixed<double, xt::xshape<3>>;
+    using col_type = xt::xtensor_fixed<double, xt::xshape<N>>;
+    using matrix_type = xt::xtensor_fixed<double, xt::xshape<N, 3>>;
+
+  private:
+    static_assert(N > 0, "FixedBatchVector length must be positive");
+    matrix_type cache_data;
+    bool initialized = false;
+    std::size_t head = 0;
+    static constexpr std::size_t physical_row(std::size_t head, std::size_t index)
+    {
+        return (head + index) % N;
+    }
+
+  public:
+    int clock_step = 0;
+
+    FixedBatchVector() { cache_data.fill(0.0); }
+
+    static constexpr std::size_t length() { return N; }
+    bool is_initialized() const { return initialized; }
+
+    matrix_type data() const
+    {
+        matrix_type ordered;
+        for (std::size_t i = 0; i < N; i++)
+        {
+            std::size_t r = physical_row(head, i);
+            ordered(i, 0) = cache_data(r, 0);
+            ordered(i, 1) = cache_data(r, 1);
+            ordered(i, 2) = cache_data(r, 2);
+        }
+        return ordered;
+    }
+
+    row_type row_element(std::size_t index) const
+    {
+        std::size_t r = physical_row(head, index);
+        row_type row;
+        row(0) = cache_data(r, 0);
+        row(1) = cache_data(r, 1);
+        row(2) = cache_data(r, 2);
+        return row;
+    }
+
+    col_type col_element(std::size_t index) const
+    {
+        col_type column;
+        for (std::size_t i = 0; i < N; i++)
+        {
+            column(i) = cache_data(physical_row(head, i), index);
+        }
+        return column;
+    }
+
+    void update(double x, double y, double z)
+    {
+        // first element is the latest element
+        clock_step = clock_step + 1;
+        if (clock_step > static_cast<int>(N))
+        {
+            initialized = true;
+        }
+        head = (head + N - 1) % N;
+        cache_data(head, 0) = x;
+        cache_data(head, 1) = y;
+        cache_data(head, 2) = z;
+    }
+
+    template <class E>
+    void update(const E& new_vector)
+    {
+        update(new_vector[0], new_vector[1], new_vector[2]);
+    }
 };
-#endif 
\ No newline at end of file
+#endif 
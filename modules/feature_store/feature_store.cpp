@@ -1,38 +1,56 @@
 #include "feature_store.h"
+#include "angle_math.h"
+#include <algorithm>
 
 Feature_Store::Feature_Store(
     double deltaT,
     int based_window,
     int cache_length,
-    int max_sequence_length
-) : deltaT(deltaT),
+    int max_sequence_length,
+    int smooth_window,
+    bool lazy_sequence
+) : track_history(cache_length),
+    deltaT(deltaT),
     based_window(based_window),
     cache_length(cache_length),
     max_sequence_length(max_sequence_length),
     track_initialized(false),
     image_initialized(false),
-    sequence_ready(false)
+    sequence_ready(false),
+    smooth_window(std::max(1, std::min(smooth_window, cache_length))),
+    smooth_v_stats(this->smooth_window),
+    smooth_a_stats(this->smooth_window),
+    lazy_sequence(lazy_sequence)
 {
-    this->Observe = new BatchVector(cache_length);
-    this->Filter_P = new BatchVector(cache_length);
-    this->Filter_V = new BatchVector(cache_length);
-    this->Filter_a = new BatchVector(cache_length);
-    this->Base_Vector = new BatchVector(cache_length);
-    this->Filter_V_Target = new BatchVector(cache_length);
-    this->Filter_a_Target = new BatchVector(cache_length);
-    this->Filter_x_Target = new BatchVector(cache_length);
+    // 惰性模式在查询时回溯计算，最旧一帧的平滑窗口必须仍在缓存中
+    if (lazy_sequence && max_sequence_length - 1 + this->smooth_window > cache_length) {
+        throw std::runtime_error("cache_length too short for lazy sequence features");
+    }
 }
 
 Feature_Store::~Feature_Store()
 {
-  delete  Observe;
-  delete  Filter_P;
-  delete  Filter_V;
-  delete  Filter_a;
-  delete  Base_Vector;
-  delete  Filter_x_Target; 
-  delete  Filter_V_Target;
-  delete  Filter_a_Target;
+}
+
+void Feature_Store::reset()
+{
+  this->track_history.reset();
+  this->image_data.reset();   // 图像不随对象复用保留
+  this->figure_probs.clear();
+  this->track_initialized = false;
+  this->image_initialized = false;
+  while (!this->sequence_features.empty())
+  {
+    this->spare_features.push_back(std::move(this->sequence_features.back()));
+    this->sequence_features.pop_back();
+  }
+  this->sequence_steps.clear();
+  this->sequence_ready = false;
+  this->smooth_v_stats = SlidingWindowStats(this->smooth_window);
+  this->smooth_a_stats = SlidingWindowStats(this->smooth_window);
+  this->target_frame = TargetFrame();
+  std::fill(this->normalized_ring.begin(), this->normalized_ring.end(), 0.0f);
+  this->ring_write = 0;
 }
 
 void Feature_Store::update(          
@@ -49,51 +67,125 @@ void Feature_Store::update(
     double Filter_a_y,
     double Filter_a_z
 )
+{
+    if (this->update_track(
+        Observe_x, Observe_y, Observe_z,
+        Filter_P_x, Filter_P_y, Filter_P_z,
+        Filter_V_x, Filter_V_y, Filter_V_z,
+        Filter_a_x, Filter_a_y, Filter_a_z))
+    {
+        update_sequence_features(this->smooth_window);
+    }
+}
+
+void Feature_Store::update_bulk(const TraceMeasurement* measurements, int count)
+{
+  for (int i = 0; i < count; i++)
+  {
+    const TraceMeasurement& m = measurements[i];
+    bool push = this->update_track(
+        m.obs[0], m.obs[1], m.obs[2],
+        m.filter_p[0], m.filter_p[1], m.filter_p[2],
+        m.filter_v[0], m.filter_v[1], m.filter_v[2],
+        m.filter_a[0], m.filter_a[1], m.filter_a[2]);
+    // 之后还会有至少max_sequence_length帧入序列，本帧必然被挤出
+    if (push && count - i <= this->max_sequence_length)
+    {
+      update_sequence_features(this->smooth_window);
+    }
+  }
+}
+
+void Feature_Store::prefetch_update() const
+{
+  this->track_history.prefetch_next_slot();
+#if defined(__GNUC__)
+  // 离开平滑窗口的行在更新开头读取
+  __builtin_prefetch(this->track_history.row(FILTER_V_TARGET, this->smooth_window-1).ptr);
+#endif
+}
+
+bool Feature_Store::update_track(
+    double Observe_x,
+    double Observe_y,
+    double Observe_z,
+    double Filter_P_x,
+    double Filter_P_y,
+    double Filter_P_z,
+    double Filter_V_x,
+    double Filter_V_y,
+    double Filter_V_z,
+    double Filter_a_x,
+    double Filter_a_y,
+    double Filter_a_z
+)
 {
     
-    this->Observe->update(Observe_x,Observe_y,Observe_z);
-    this->Filter_P->update(Filter_P_x,Filter_P_y,Filter_P_z);
-    this->Filter_V->update(Filter_V_x,Filter_V_y,Filter_V_z);
-    this->Filter_a->update(Filter_a_x,Filter_a_y,Filter_a_z);
-    if(this->Filter_P->clock_step >= this->based_window)
+    // 即将离开平滑窗口的行，需在head前移覆盖之前取出
+    Vec3 leaving_v = this->copy_row(FILTER_V_TARGET, this->smooth_window-1);
+    Vec3 leaving_a = this->copy_row(FILTER_A_TARGET, this->smooth_window-1);
+
+    // 所有通道共用一个head，每次更新只前移一次
+    this->track_history.advance();
+    this->track_history.set(OBSERVE,Observe_x,Observe_y,Observe_z);
+    this->track_history.set(FILTER_P,Filter_P_x,Filter_P_y,Filter_P_z);
+    this->track_history.set(FILTER_V,Filter_V_x,Filter_V_y,Filter_V_z);
+    this->track_history.set(FILTER_A,Filter_a_x,Filter_a_y,Filter_a_z);
+    if(this->track_history.clock_step() >= this->based_window)
     {
-        xt::xarray<double>  current_base = this->Sub(
-          this->Mul(this->Filter_P->row_element(0),1.0/this->deltaT/this->based_window),
-          this->Mul(this->Filter_P->row_element(this->based_window-1),1.0/this->deltaT/this->based_window)
+        Vec3  current_base = this->Sub(
+          this->Mul(this->track_history.row(FILTER_P,0),1.0/this->deltaT/this->based_window),
+          this->Mul(this->track_history.row(FILTER_P,this->based_window-1),1.0/this->deltaT/this->based_window)
         );
-        this->Base_Vector->update(current_base);
-        this->Filter_x_Target->update(
-          this->Real2Target(
-            this->Filter_P->row_element(0),
-            this->Base_Vector->row_element(0)
-          )
+        this->track_history.set(BASE_VECTOR,current_base);
+        // 旋转矩阵每次更新只计算一次，位置、速度、加速度共用
+        this->target_frame = TargetFrame(current_base);
+        this->track_history.set(FILTER_X_TARGET,
+          this->target_frame.to_target(this->track_history.row(FILTER_P,0))
         );
         //compute 
-        this->Filter_V_Target->update(
-          this->Real2Target(
-            this->Filter_V->row_element(0),
-            this->Base_Vector->row_element(0)
-          )
+        this->track_history.set(FILTER_V_TARGET,
+          this->target_frame.to_target(this->track_history.row(FILTER_V,0))
         );
-        this->Filter_a_Target->update(
-          this->Real2Target(
-            this->Filter_a->row_element(0),
-            this->Base_Vector->row_element(0)
-          )
+        this->track_history.set(FILTER_A_TARGET,
+          this->target_frame.to_target(this->track_history.row(FILTER_A,0))
         );
-        update_sequence_features();
+        this->track_history.mark_derived();
+    }
+
+    // 基准窗口未满时目标系通道为0，窗口统计同样按0计入
+    update_smooth_stats(leaving_v, leaving_a);
+    if (this->lazy_sequence)
+    {
+        // 惰性模式只记录进度，特征在查询序列时再计算
+        this->sequence_ready = this->track_history.derived_step() >= this->max_sequence_length;
+        return false;
+    }
+    return this->track_history.derived_step() > 0;
+}
+
+Vec3 Feature_Store::copy_row(TrackChannel channel, int index) const
+{
+    RowView row = this->track_history.row(channel, index);
+    return Vec3(row[0], row[1], row[2]);
+}
+
+void Feature_Store::update_smooth_stats(const Vec3& leaving_v, const Vec3& leaving_a)
+{
+    this->smooth_v_stats.update(this->track_history.row(FILTER_V_TARGET,0), leaving_v);
+    this->smooth_a_stats.update(this->track_history.row(FILTER_A_TARGET,0), leaving_a);
+    if (this->smooth_v_stats.needs_resync())
+    {
+        this->smooth_v_stats.resync(this->track_history, FILTER_V_TARGET);
+    }
+    if (this->smooth_a_stats.needs_resync())
+    {
+        this->smooth_a_stats.resync(this->track_history, FILTER_A_TARGET);
     }
 }
 
 bool Feature_Store::is_track_initialized() const {
-    return this->Observe->is_initialized() && 
-           this->Filter_P->is_initialized() && 
-           this->Filter_V->is_initialized() && 
-           this->Filter_a->is_initialized() &&
-           this->Base_Vector->is_initialized() &&
-           this->Filter_x_Target->is_initialized() &&
-           this->Filter_V_Target->is_initialized() &&
-           this->Filter_a_Target->is_initialized();
+    return this->track_history.is_initialized();
 }
 
 bool Feature_Store::is_image_initialized() const {
@@ -105,122 +197,118 @@ bool Feature_Store::is_fully_initialized() const {
 }
 
 void Feature_Store::compute_smooth_features(int smooth_window,
-    const xt::xarray<double>& filter_v_target,
-    const xt::xarray<double>& filter_a_target,
-    xt::xarray<double>& smooth_stdv,
-    xt::xarray<double>& smooth_meanv,
-    xt::xarray<double>& smooth_stda,
-    xt::xarray<double>& smooth_meana
-)
-{
-    smooth_stdv = this->Smooth_Std(filter_v_target, smooth_window);
-    smooth_meanv = this->Smooth_Mean(filter_v_target, smooth_window);
-    smooth_stda = this->Smooth_Std(filter_a_target, smooth_window);
-    smooth_meana = this->Smooth_Mean(filter_a_target, smooth_window);
-}
-
-void Feature_Store::compute_curvature_features(
-    const xt::xarray<double>& smooth_meanv,
-    const xt::xarray<double>& smooth_meana,
-    const xt::xarray<double>& smooth_stdv,
-    const xt::xarray<double>& smooth_stda,
-    std::vector<double>& features
-)
+    int offset,
+    Vec3& smooth_stdv,
+    Vec3& smooth_meanv,
+    Vec3& smooth_stda,
+    Vec3& smooth_meana
+) const
 {
-    features.push_back(this->Curvature(this->Filter_V->row_element(0), this->Filter_a->row_element(0)));
-    features.push_back(this->Curvature(smooth_meanv, smooth_meana));
-    features.push_back(this->Curvature(smooth_stdv, smooth_stda));
-    features.push_back(this->Curvature(smooth_stdv, smooth_meana));
-    features.push_back(this->Curvature(smooth_meanv, smooth_stda));
-}
-
-void Feature_Store::compute_similarity_features(
-    const xt::xarray<double>& smooth_meanv,
-    const xt::xarray<double>& smooth_meana,
-    const xt::xarray<double>& smooth_stdv,
-    const xt::xarray<double>& smooth_stda,
-    std::vector<double>& features
-)
+    if (offset == 0 && smooth_window == this->smooth_window)
+    {
+        // 最新时刻直接读取增量维护的统计量
+        smooth_stdv = this->smooth_v_stats.stddev();
+        smooth_meanv = this->smooth_v_stats.mean();
+        smooth_stda = this->smooth_a_stats.stddev();
+        smooth_meana = this->smooth_a_stats.mean();
+        return;
+    }
+    smooth_stdv = this->Smooth_Std(this->track_history, FILTER_V_TARGET, smooth_window, offset);
+    smooth_meanv = this->Smooth_Mean(this->track_history, FILTER_V_TARGET, smooth_window, offset);
+    smooth_stda = this->Smooth_Std(this->track_history, FILTER_A_TARGET, smooth_window, offset);
+    smooth_meana = this->Smooth_Mean(this->track_history, FILTER_A_TARGET, smooth_window, offset);
+}
+
+std::vector<double> Feature_Store::get_trace_features(int smooth_window)
 {
-    features.push_back(this->Similarity(this->Filter_V->row_element(0), this->Filter_a->row_element(0)));
-    features.push_back(this->Similarity(smooth_meanv, smooth_meana));
-    features.push_back(this->Similarity(smooth_stdv, smooth_stda));
-    features.push_back(this->Similarity(smooth_stdv, smooth_meana));
-    features.push_back(this->Similarity(smooth_meanv, smooth_stda));
-}
-
-void Feature_Store::compute_angle_features(
-    const xt::xarray<double>& filter_x_target,
-    const xt::xarray<double>& filter_v_target,
-    const xt::xarray<double>& filter_a_target,
-    std::vector<double>& features
-)
+    std::vector<double> features(TRACE_FEATURE_DIM);
+    get_trace_features(features.data(), smooth_window);
+    return features;
+}
+
+void Feature_Store::get_trace_features(double* features, int smooth_window)
 {
-    // 方位角
-    features.push_back(this->CalAzimuth(filter_x_target));
-    features.push_back(this->CalAzimuth(filter_v_target));
-    features.push_back(this->CalAzimuth(filter_a_target));
-    
-    // 仰角
-    features.push_back(this->CalElevation(filter_x_target));
-    features.push_back(this->CalElevation(filter_v_target));
-    features.push_back(this->CalElevation(filter_a_target));
+    compute_trace_features(get_trace_input(smooth_window, 0), features);
 }
 
-std::vector<double> Feature_Store::get_trace_features(int smooth_window)
+TraceFeatureInput Feature_Store::get_trace_input(int smooth_window, int time_step) const
 {
-    std::vector<double> features;
-    features.reserve(37);  // 预分配空间，与Python版本特征数量一致
-    // 添加基础目标系特征
-    for (int i = 0; i < 3; i++) {
-        features.push_back(this->Filter_x_Target->row_element(0)[i]);
-    };
-    for (int i = 0; i < 3; i++) {
-        features.push_back(this->Filter_V_Target->row_element(0)[i]);
-    };
-    for (int i = 0; i < 3; i++) {
-        features.push_back(this->Filter_a_Target->row_element(0)[i]);
-    };
-    //2. 计算平滑特征
-    xt::xarray<double> smooth_stdv, smooth_meanv, smooth_stda, smooth_meana;
+    TraceFeatureInput input;
+    input.x_target = copy_row(FILTER_X_TARGET, time_step);
+    input.v_target = copy_row(FILTER_V_TARGET, time_step);
+    input.a_target = copy_row(FILTER_A_TARGET, time_step);
+    input.filter_v = copy_row(FILTER_V, time_step);
+    input.filter_a = copy_row(FILTER_A, time_step);
     compute_smooth_features(
-      smooth_window, 
-      this->Filter_V_Target->row_element(0), 
-      this->Filter_a_Target->row_element(0),
-      smooth_stdv, 
-      smooth_meanv, 
-      smooth_stda, 
-      smooth_meana
+      smooth_window,
+      time_step,
+      input.stdv,
+      input.meanv,
+      input.stda,
+      input.meana
     );
-    for (int i = 0; i < 3; i++) {
-        features.push_back(smooth_stdv[i]);
-    };
-    for (int i = 0; i < 3; i++) {
-        features.push_back(smooth_meanv[i]);
-    };
-    for (int i = 0; i < 3; i++) {
-        features.push_back(smooth_stda[i]);
-    };
-    for (int i = 0; i < 3; i++) {
-        features.push_back(smooth_meana[i]);
-    };
+    return input;
+}
 
-    //3. 计算曲率特征
-    compute_curvature_features(smooth_meanv, smooth_meana, smooth_stdv, smooth_stda, features);
+// |v x a|，与Curvature中的叉乘取模运算顺序一致
+static inline double cross_modu(const Vec3& v, const Vec3& a)
+{
+  double cx = v[1]*a[2]-v[2]*a[1];
+  double cy = v[2]*a[0]-v[0]*a[2];
+  double cz = v[0]*a[1]-v[1]*a[0];
+  return sqrt(cx*cx+cy*cy+cz*cz);
+}
 
-    //4. 计算相似度特征
-    compute_similarity_features(smooth_meanv, smooth_meana, smooth_stdv, smooth_stda, features);
+static inline double dot(const Vec3& v1, const Vec3& v2)
+{
+  return v1[0]*v2[0]+v1[1]*v2[1]+v1[2]*v2[2];
+}
 
-    //5. 计算角度特征
-    compute_angle_features(
-      this->Filter_x_Target->row_element(0),
-      this->Filter_V_Target->row_element(0),
-      this->Filter_a_Target->row_element(0),
-      features
-    );
-  
+void Feature_Store::compute_trace_features(const TraceFeatureInput& input, double* features)
+{
+    //1. 目标系特征与平滑特征
+    const Vec3* blocks[7] = {
+      &input.x_target, &input.v_target, &input.a_target,
+      &input.stdv, &input.meanv, &input.stda, &input.meana
+    };
+    for (int b = 0; b < 7; b++) {
+        features[b*3] = (*blocks[b])[0];
+        features[b*3+1] = (*blocks[b])[1];
+        features[b*3+2] = (*blocks[b])[2];
+    }
 
-    return features;
+    // 各向量的模只计算一次，曲率分母中的三次方同样复用
+    double mod_fv = Modu(input.filter_v);
+    double mod_fa = Modu(input.filter_a);
+    double mod_meanv = Modu(input.meanv);
+    double mod_meana = Modu(input.meana);
+    double mod_stdv = Modu(input.stdv);
+    double mod_stda = Modu(input.stda);
+    double cube_fv = pow(mod_fv,3.0)+EPSILON;
+    double cube_meanv = pow(mod_meanv,3.0)+EPSILON;
+    double cube_stdv = pow(mod_stdv,3.0)+EPSILON;
+
+    //2. 曲率特征
+    features[21] = cross_modu(input.filter_v, input.filter_a)/cube_fv;
+    features[22] = cross_modu(input.meanv, input.meana)/cube_meanv;
+    features[23] = cross_modu(input.stdv, input.stda)/cube_stdv;
+    features[24] = cross_modu(input.stdv, input.meana)/cube_stdv;
+    features[25] = cross_modu(input.meanv, input.stda)/cube_meanv;
+
+    //3. 相似度特征
+    features[26] = dot(input.filter_v, input.filter_a)/(mod_fv+EPSILON)/(mod_fa+EPSILON);
+    features[27] = dot(input.meanv, input.meana)/(mod_meanv+EPSILON)/(mod_meana+EPSILON);
+    features[28] = dot(input.stdv, input.stda)/(mod_stdv+EPSILON)/(mod_stda+EPSILON);
+    features[29] = dot(input.stdv, input.meana)/(mod_stdv+EPSILON)/(mod_meana+EPSILON);
+    features[30] = dot(input.meanv, input.stda)/(mod_meanv+EPSILON)/(mod_stda+EPSILON);
+
+    //4. 角度特征：方位角、仰角
+    features[31] = CalAzimuth(input.x_target);
+    features[32] = CalAzimuth(input.v_target);
+    features[33] = CalAzimuth(input.a_target);
+    features[34] = CalElevation(input.x_target);
+    features[35] = CalElevation(input.v_target);
+    features[36] = CalElevation(input.a_target);
 }
 
 
@@ -237,7 +325,7 @@ double Feature_Store::Dif(
 
 
 double Feature_Store::Modu(
-  const xt::xarray<double>& row_vector
+  RowView row_vector
 )
 {
    return sqrt(row_vector[0]*row_vector[0]+row_vector[1]*row_vector[1]+row_vector[2]*row_vector[2]);
@@ -246,101 +334,23 @@ double Feature_Store::Modu(
 
 
 double Feature_Store::CalElevation(
-  const xt::xarray<double>& row_vector
+  RowView row_vector
 )
 {
-  double gdj,h,R;
-  h =row_vector[2];
-  R = sqrt(row_vector[0]*row_vector[0]+row_vector[1]*row_vector[1]);
-  if ((R<EPSILON)&&(R>-EPSILON))
-  {
-    if ((h<EPSILON)&&(h>-EPSILON))
-    {
-      gdj = 0.0;
-    }
-    else
-    {
-      if (h>EPSILON)
-      {
-        gdj = 1500.0/RADTOMIL;
-      }
-      else
-      {
-        gdj = -1500.0/RADTOMIL;
-      }
-    }
-  }
-  else
-  {
-    gdj = atan(h/R);
-  }
-  return gdj;
+  return branchless_elevation(row_vector[0], row_vector[1], row_vector[2], false);
 }
 
 
 double Feature_Store::CalAzimuth(
-  const xt::xarray<double>& row_vector
+  RowView row_vector
 )
 {
-  double nAzimuth = 0.0;
-  double x = row_vector[0];
-  double y = row_vector[1];
-  if ((x<EPSILON) && (x>-EPSILON))
-  {
-    if((y<EPSILON)&&(y>-EPSILON))
-    {
-      nAzimuth = 0.0;
-    }
-    else
-    {
-      if(y >0.0)
-      {
-        nAzimuth = 1500.0/RADTOMIL;
-      }
-      else
-      {
-        nAzimuth = 4500.0/RADTOMIL;
-      }
-    }
-  }
-  else
-  {
-    if(x>0.0)
-    {
-      if ((y<EPSILON)&&(y>-EPSILON))
-      {
-        nAzimuth = 0.0;
-      }
-      else
-      {
-        if(y>0.0)
-        {
-          nAzimuth = atan(y/x);
-        }
-        else
-        {
-          nAzimuth = atan(y/x)+6000.0/RADTOMIL;
-        }
-      }
-    }
-    else
-    {
-      if((y<EPSILON)&&(y>-EPSILON))
-      {
-        nAzimuth = 3000.0/RADTOMIL;
-      }
-      else
-      {
-        nAzimuth = atan(y/x)+3000.0/RADTOMIL;
-      }
-    }
-  }
-  return nAzimuth;
+  return branchless_azimuth(row_vector[0], row_vector[1], false);
 }
 
 double Feature_Store::Similarity(
-  const xt::xarray<double>& row_vector1,
-  const xt::xarray<double>& row_vector2
+  RowView row_vector1,
+  RowView row_vector2
 )
 {
   double result = row_vector1[0]*row_vector2[0]+row_vector1[1]*row_vector2[1]+row_vector1[2]*row_vector2[2];
@@ -348,11 +358,11 @@ double Feature_Store::Similarity(
 }
 
 double Feature_Store::Curvature(
-  const xt::xarray<double>& rowVel,
-  const xt::xarray<double>& rowAcc
+  RowView rowVel,
+  RowView rowAcc
 )
 {
-  xt::xarray<double> cross_dot = {rowVel[1]*rowAcc[2]-rowVel[2]*rowAcc[1],
+  Vec3 cross_dot = {rowVel[1]*rowAcc[2]-rowVel[2]*rowAcc[1],
                                   rowVel[2]*rowAcc[0]-rowVel[0]*rowAcc[2],
                                   rowVel[0]*rowAcc[1]-rowVel[1]*rowAcc[0]};
   double result =  Modu(cross_dot)/(pow(Modu(rowVel),3.0)+EPSILON);
@@ -360,12 +370,12 @@ double Feature_Store::Curvature(
 }
 
 
-xt::xarray<double> Feature_Store::Mul(
-    const xt::xarray<double>&  row_vector,
+Vec3 Feature_Store::Mul(
+    RowView  row_vector,
     double multi_rate
 )
 {
-    xt::xarray<double>  result = {
+    Vec3  result = {
       row_vector[0]*multi_rate,
       row_vector[1]*multi_rate,
       row_vector[2]*multi_rate
@@ -373,12 +383,12 @@ xt::xarray<double> Feature_Store::Mul(
     return result;
 }
 
-xt::xarray<double> Feature_Store::Add(
-    const xt::xarray<double>&  row_vector1,
-    const xt::xarray<double>&  row_vector2
+Vec3 Feature_Store::Add(
+    RowView  row_vector1,
+    RowView  row_vector2
 )
 {
-    xt::xarray<double>  result = {
+    Vec3  result = {
       row_vector1[0] + row_vector2[0],
       row_vector1[1] + row_vector2[1],
       row_vector1[2] + row_vector2[2]
@@ -386,11 +396,11 @@ xt::xarray<double> Feature_Store::Add(
     return result;
 }
 
-xt::xarray<double> Feature_Store::Sub(
-    const xt::xarray<double>&  row_vector1,
-    const xt::xarray<double>&  row_vector2)
+Vec3 Feature_Store::Sub(
+    RowView  row_vector1,
+    RowView  row_vector2)
 {
-    xt::xarray<double>  result = {
+    Vec3  result = {
       row_vector1[0] - row_vector2[0],
       row_vector1[1] - row_vector2[1],
       row_vector1[2] - row_vector2[2]
@@ -399,193 +409,256 @@ xt::xarray<double> Feature_Store::Sub(
 }
 
 
-xt::xarray<double> Feature_Store::Dif(
-    const xt::xarray<double>&  matrix,
+Vec3 Feature_Store::Dif(
+    const TrackHistory&  history,
+    TrackChannel channel,
     int window,
-    double deltaT=0.08
+    double deltaT,
+    int offset
 )
 {
-    xt::xarray<double>  result = {
-        Dif(matrix(0,0),matrix(window,0),window,deltaT),
-        Dif(matrix(0,1),matrix(window,1),window,deltaT),
-        Dif(matrix(0,2),matrix(window,2),window,deltaT)
+    RowView latest = history.row(channel,offset);
+    RowView earliest = history.row(channel,offset+window);
+    Vec3  result = {
+        Dif(latest[0],earliest[0],window,deltaT),
+        Dif(latest[1],earliest[1],window,deltaT),
+        Dif(latest[2],earliest[2],window,deltaT)
         };
     return result;
 }
 
 
-xt::xarray<double> Feature_Store::Smooth_Mean(
-    const xt::xarray<double>&  matrix,
-    int window
-)
+Vec3 Feature_Store::Smooth_Mean(
+    const TrackHistory&  history,
+    TrackChannel channel,
+    int window,
+    int offset
+) const
 {
-    return xt::mean(xt::view(matrix,xt::range(0,window),xt::all()),{0});
+    // 对 [offset, offset+window) 行按列求均值
+    window = std::min(window, history.size() - offset);
+    Vec3 result;
+    for (int i = 0; i < window; i++)
+    {
+        RowView row = history.row(channel,offset+i);
+        result[0] += row[0];
+        result[1] += row[1];
+        result[2] += row[2];
+    }
+    for (int j = 0; j < 3; j++)
+    {
+        result[j] /= window;
+    }
+    return result;
 }
 
-xt::xarray<double> Feature_Store::Smooth_Std(
-    const xt::xarray<double>&  matrix,
-    int window
-)
+Vec3 Feature_Store::Smooth_Std(
+    const TrackHistory&  history,
+    TrackChannel channel,
+    int window,
+    int offset
+) const
 {
-    return xt::stddev(xt::view(matrix,xt::range(0,window),xt::all()),{0});
+    // 总体标准差（ddof=0），与xt::stddev及Python端一致
+    window = std::min(window, history.size() - offset);
+    Vec3 mean = Smooth_Mean(history, channel, window, offset);
+    Vec3 result;
+    for (int i = 0; i < window; i++)
+    {
+        RowView row = history.row(channel,offset+i);
+        for (int j = 0; j < 3; j++)
+        {
+            double d = row[j] - mean[j];
+            result[j] += d*d;
+        }
+    }
+    for (int j = 0; j < 3; j++)
+    {
+        result[j] = sqrt(result[j]/window);
+    }
+    return result;
 }
 
 
 //vector2vector Operator 
-xt::xarray<double> Feature_Store::Real2Target(
-  const xt::xarray<double>& real_row_vector,
-  const xt::xarray<double>& base_row_vector
+Vec3 Feature_Store::Real2Target(
+  RowView real_row_vector,
+  RowView base_row_vector
 )
 {
-  double beta_h = CalAzimuth(base_row_vector);
-  double beta_l = CalElevation(base_row_vector);
-  double Tx = cos(beta_h)*cos(beta_l)*real_row_vector[0]+\
-              sin(beta_h)*cos(beta_l)*real_row_vector[1]+\
-              sin(beta_l)*real_row_vector[2];
-  double Ty = -sin(beta_h)*real_row_vector[0]+\
-              cos(beta_h)*real_row_vector[1];
-  double Tz = -cos(beta_h)*sin(beta_l)*real_row_vector[0]+\
-              -sin(beta_h)*sin(beta_l)*real_row_vector[1]+\
-              cos(beta_l)*real_row_vector[2];     
-  xt::xarray<double> result = {Tx,Ty,Tz};
-  return result;
+  return TargetFrame(base_row_vector).to_target(real_row_vector);
 }
 
-xt::xarray<double> Feature_Store::Target2Real(
-  const xt::xarray<double>& target_row_vector,
-  const xt::xarray<double>& base_row_vector
+Vec3 Feature_Store::Target2Real(
+  RowView target_row_vector,
+  RowView base_row_vector
 )
 {
-  double beta_h = CalAzimuth(base_row_vector);
-  double beta_l = CalElevation(base_row_vector);
-  double Tx = cos(beta_h)*cos(beta_l)*target_row_vector[0]+\
-              -sin(beta_h)*target_row_vector[1]+\
-              -sin(beta_l)*cos(beta_h)*target_row_vector[2];
-  double Ty = sin(beta_h)*cos(beta_l)*target_row_vector[0]+\
-              cos(beta_h)*target_row_vector[1]+\
-              -sin(beta_h)*sin(beta_l)*target_row_vector[2];
-  double Tz = sin(beta_l)*target_row_vector[0]+\
-              0+\
-              cos(beta_l)*target_row_vector[2];     
-  xt::xarray<double> result = {Tx,Ty,Tz};
-  return result;
+  return TargetFrame(base_row_vector).to_real(target_row_vector);
 }
 
 void Feature_Store::update_image(const std::vector<unsigned char >& new_image_data) {
-    image_data = new_image_data;
+    update_image(std::make_shared<const std::vector<unsigned char>>(new_image_data));
+}
+
+void Feature_Store::update_image(std::vector<unsigned char >&& new_image_data) {
+    update_image(std::make_shared<const std::vector<unsigned char>>(std::move(new_image_data)));
+}
+
+void Feature_Store::update_image(ImageBuffer new_image_data) {
+    if (!new_image_data) {
+        throw std::runtime_error("Empty image buffer");
+    }
+    image_data = std::move(new_image_data);
     image_initialized = true;
+    figure_probs.clear();
 }
 
-const std::vector<unsigned char >& Feature_Store::get_image_data() const {
-    return image_data;
+size_t Feature_Store::release_image() {
+    size_t freed = image_bytes();
+    image_data.reset();
+    if (figure_probs.empty()) {
+        image_initialized = false;
+    }
+    return freed;
 }
 
-std::vector<std::vector<double>> Feature_Store::get_trace_features_sequence(
-    int sequence_length,
-    int smooth_window,
-    int stride,
-    bool allow_incomplete
-) {
-    // 检查序列完整性
-    if (!allow_incomplete && !has_complete_sequence(sequence_length)) {
-        throw std::runtime_error("Incomplete sequence data");
-    }
-
-    std::vector<std::vector<double>> sequence_features;
-    sequence_features.reserve(sequence_length);
-
-    // 计算起始时间步
-    int start_step = std::max(0, 
-        static_cast<int>(Filter_P->clock_step) - sequence_length * stride);
-
-    // 从最早的时间步开始收集特征
-    for (int i = 0; i < sequence_length; ++i) {
-        int time_step = start_step + i * stride;
-        if (time_step >= Filter_P->clock_step) {
-            if (!allow_incomplete) {
-                throw std::runtime_error("Sequence truncated");
-            }
-            break;
-        }
-        sequence_features.push_back(
-            compute_single_timestep_features(time_step, smooth_window)
-        );
+size_t Feature_Store::memory_usage() const {
+    size_t bytes = sizeof(Feature_Store);
+    bytes += static_cast<size_t>(track_history.size()) * TrackHistory::SLOT_STRIDE * sizeof(double);
+    for (const auto& features : sequence_features) {
+        bytes += features.capacity() * sizeof(double);
+    }
+    for (const auto& features : spare_features) {
+        bytes += features.capacity() * sizeof(double);
     }
+    bytes += (feature_mean.capacity() + feature_scale.capacity()) * sizeof(double);
+    bytes += normalized_ring.capacity() * sizeof(float);
+    bytes += figure_probs.capacity() * sizeof(float);
+    bytes += image_bytes();
+    return bytes;
+}
 
-    return sequence_features;
+const std::vector<unsigned char >& Feature_Store::get_image_data() const {
+    static const std::vector<unsigned char> empty_image;
+    return image_data ? *image_data : empty_image;
 }
 
 std::vector<double> Feature_Store::compute_single_timestep_features(
     int time_step,
     int smooth_window
 ) {
-    // 获取指定时间步的数据
-    xt::xarray<double> filter_x_target = this->Filter_x_Target->row_element(time_step);
-    xt::xarray<double> filter_v_target = this->Filter_V_Target->row_element(time_step);
-    xt::xarray<double> filter_a_target = this->Filter_a_Target->row_element(time_step);
-
-    // 计算平滑特征
-    xt::xarray<double> smooth_stdv, smooth_meanv, smooth_stda, smooth_meana;
-    compute_smooth_features(
-        smooth_window,
-        filter_v_target,
-        filter_a_target,
-        smooth_stdv,
-        smooth_meanv,
-        smooth_stda,
-        smooth_meana
-    );
+    std::vector<double> features(TRACE_FEATURE_DIM);
+    compute_trace_features(get_trace_input(smooth_window, time_step), features.data());
+    return features;
+}
 
-    // 收集所有特征
-    std::vector<double> features;
-    features.reserve(37); // 预分配空间
+void Feature_Store::update_sequence_features(int smooth_window) {
+    double current_features[TRACE_FEATURE_DIM];
+    get_trace_features(current_features, smooth_window);
+    push_sequence_features(current_features);
+}
 
-    // 添加基础特征
-    for (int i = 0; i < 3; ++i) {
-        features.push_back(filter_x_target[i]);
-        features.push_back(filter_v_target[i]);
-        features.push_back(filter_a_target[i]);
+void Feature_Store::push_sequence_features(const double* features) {
+    // 序列已满时复用最旧一帧的存储，稳态下不再分配
+    std::vector<double> current_features;
+    if (sequence_features.size() >= max_sequence_length) {
+        current_features = std::move(sequence_features.front());
+        sequence_features.pop_front();
+    } else if (!spare_features.empty()) {
+        current_features = std::move(spare_features.back());
+        spare_features.pop_back();
     }
-
-    // 添加平滑特征
-    for (int i = 0; i < 3; ++i) {
-        features.push_back(smooth_stdv[i]);
-        features.push_back(smooth_meanv[i]);
-        features.push_back(smooth_stda[i]);
-        features.push_back(smooth_meana[i]);
+    current_features.assign(features, features + TRACE_FEATURE_DIM);
+    sequence_features.push_back(std::move(current_features));
+    sequence_ready = (sequence_features.size() == max_sequence_length);
+    if (!feature_mean.empty()) {
+        push_normalized_features(features);
     }
+}
 
-    // 计算并添加其他特征
-    std::vector<double> temp_features;
-    compute_curvature_features(smooth_meanv, smooth_meana, smooth_stdv, smooth_stda, temp_features);
-    features.insert(features.end(), temp_features.begin(), temp_features.end());
+void Feature_Store::push_normalized_features(const double* features) {
+    float* first = normalized_ring.data() + static_cast<size_t>(ring_write) * TRACE_FEATURE_DIM;
+    float* second = first + static_cast<size_t>(max_sequence_length) * TRACE_FEATURE_DIM;
+    for (int i = 0; i < TRACE_FEATURE_DIM; ++i) {
+        // 与TracePreprocessor::transform相同：双精度计算后转为float
+        float value = static_cast<float>((features[i] - feature_mean[i]) / feature_scale[i]);
+        first[i] = value;
+        second[i] = value;
+    }
+    ring_write = (ring_write + 1) % max_sequence_length;
+}
 
-    compute_similarity_features(smooth_meanv, smooth_meana, smooth_stdv, smooth_stda, temp_features);
-    features.insert(features.end(), temp_features.begin(), temp_features.end());
+void Feature_Store::set_feature_normalization(
+    const std::vector<double>& mean,
+    const std::vector<double>& scale
+) {
+    if (mean.size() != TRACE_FEATURE_DIM || scale.size() != TRACE_FEATURE_DIM) {
+        throw std::runtime_error("Feature normalization size does not match feature dimension");
+    }
+    feature_mean = mean;
+    feature_scale = scale;
+    normalized_ring.assign(static_cast<size_t>(2) * max_sequence_length * TRACE_FEATURE_DIM, 0.0f);
+    ring_write = 0;
+    for (const auto& features : sequence_features) {
+        push_normalized_features(features.data());
+    }
+}
 
-    compute_angle_features(filter_x_target, filter_v_target, filter_a_target, temp_features);
-    features.insert(features.end(), temp_features.begin(), temp_features.end());
+const float* Feature_Store::get_normalized_sequence() {
+    if (feature_mean.empty()) {
+        throw std::runtime_error("Feature normalization not set");
+    }
+    if (lazy_sequence) {
+        materialize_sequence_features();
+    }
+    if (!sequence_ready) {
+        throw std::runtime_error("Feature sequence not ready");
+    }
+    // 序列已满时最旧一帧在ring_write行，其后max_sequence_length行连续
+    return normalized_ring.data() + static_cast<size_t>(ring_write) * TRACE_FEATURE_DIM;
+}
 
-    return features;
+const float* Feature_Store::get_normalized_sequence() const {
+    if (lazy_sequence) {
+        throw std::runtime_error("Lazy sequence features are computed on query");
+    }
+    if (feature_mean.empty()) {
+        throw std::runtime_error("Feature normalization not set");
+    }
+    if (!sequence_ready) {
+        throw std::runtime_error("Feature sequence not ready");
+    }
+    return normalized_ring.data() + static_cast<size_t>(ring_write) * TRACE_FEATURE_DIM;
 }
 
-void Feature_Store::update_sequence_features(int smooth_window) {
-    // 使用现有的特征计算方法
-    std::vector<double> current_features = get_trace_features(smooth_window);
-    
-    sequence_features.push_back(current_features);
-    if (sequence_features.size() > max_sequence_length) {
+void Feature_Store::materialize_sequence_features() {
+    // 序列条目以衍生步编号，第step步对应距最新 derived_step()-step 行的历史
+    int newest = track_history.derived_step();
+    int oldest = std::max(1, newest - max_sequence_length + 1);
+
+    // 丢弃已滑出序列的条目，其余条目已算好，直接复用
+    while (!sequence_steps.empty() && sequence_steps.front() < oldest) {
+        sequence_steps.pop_front();
+        spare_features.push_back(std::move(sequence_features.front()));
         sequence_features.pop_front();
     }
-    sequence_ready = (sequence_features.size() == max_sequence_length);
+
+    int next = sequence_steps.empty() ? oldest : sequence_steps.back() + 1;
+    double features[TRACE_FEATURE_DIM];
+    for (int step = next; step <= newest; ++step) {
+        compute_trace_features(get_trace_input(smooth_window, newest - step), features);
+        push_sequence_features(features);
+        sequence_steps.push_back(step);
+    }
 }
 
-const std::deque<std::vector<double>>& Feature_Store::get_trace_features_sequence() const {
+const std::deque<std::vector<double>>& Feature_Store::get_trace_features_sequence() {
+    if (lazy_sequence) {
+        materialize_sequence_features();
+    }
     if (!sequence_ready) {
         throw std::runtime_error("Feature sequence not ready");
     }
     return sequence_features;
 }
-
-
-
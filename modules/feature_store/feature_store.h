@@ -1,26 +1,59 @@
 #ifndef FEATURE_STORE_H 
 #define FEATURE_STORE_H
 #include <vector>
-#include "batch_vector.h" 
+#include <deque>
+#include <memory>
+#include <stdexcept>
+#include "track_history.h"
+#include "sliding_stats.h"
+#include "target_frame.h"
 #define RADTOMIL 954.9296585513
 #define EPSILON 0.0000001
+#define TRACE_FEATURE_DIM 37
+
+/**
+ * 计算单个时刻37维航迹特征所需的全部输入
+ */
+struct TraceFeatureInput
+{
+    Vec3 x_target;   // 目标系位置
+    Vec3 v_target;   // 目标系速度
+    Vec3 a_target;   // 目标系加速度
+    Vec3 filter_v;   // 滤波速度
+    Vec3 filter_a;   // 滤波加速度
+    Vec3 stdv;       // 目标系速度平滑标准差
+    Vec3 meanv;      // 目标系速度平滑均值
+    Vec3 stda;       // 目标系加速度平滑标准差
+    Vec3 meana;      // 目标系加速度平滑均值
+};
+
+/**
+ * 单个目标在一帧中的航迹量测
+ */
+struct TraceMeasurement
+{
+    int target_id;
+    double obs[3];       // 观测位置
+    double filter_p[3];  // 滤波位置
+    double filter_v[3];  // 滤波速度
+    double filter_a[3];  // 滤波加速度
+};
+
+/**
+ * 共享的只读图像缓冲区
+ * 采集层编码一次后在队列、目标与预处理之间传递同一份数据，不再复制
+ */
+using ImageBuffer = std::shared_ptr<const std::vector<unsigned char>>;
 
 class Feature_Store
 {
     public:
-        BatchVector*  Observe;        // 观测数据
-        BatchVector*  Filter_P;       // 滤波位置
-        BatchVector*  Filter_V;       // 滤波速度
-        BatchVector*  Filter_a;       // 滤波加速度
-        BatchVector*  Base_Vector;    // 基准向量
-        BatchVector*  Filter_x_Target; // 目标系位置
-        BatchVector*  Filter_V_Target; // 目标系速度
-        BatchVector*  Filter_a_Target; // 目标系加速度
+        TrackHistory  track_history;  // 观测、滤波、基准及目标系向量的历史
         
         double deltaT;                // 时间间隔
         int based_window;             // 基准窗口大小
         int cache_length;             // 缓存长度
-        std::vector<unsigned char> image_data; // 图像数据
+        ImageBuffer image_data;       // 图像数据，可能与其他持有者共享
 
     private:
         bool track_initialized = false;  // 航迹特征是否初始化
@@ -28,35 +61,26 @@ class Feature_Store
         std::deque<std::vector<double>> sequence_features;  // 存储固定长度的特征序列
         int max_sequence_length;  // 序列最大长度
         bool sequence_ready = false;      // 序列是否准备就绪
+        int smooth_window;                // 平滑窗口大小
+        SlidingWindowStats smooth_v_stats;  // 目标系速度的滑动窗口统计
+        SlidingWindowStats smooth_a_stats;  // 目标系加速度的滑动窗口统计
+        TargetFrame target_frame;           // 最新基准向量确定的目标坐标系
+        bool lazy_sequence;                 // 是否在查询时才计算序列特征
+        std::deque<int> sequence_steps;     // 惰性模式下各序列条目对应的衍生步
+        std::vector<std::vector<double>> spare_features;  // reset后回收的序列条目存储，供再次使用
+        std::vector<double> feature_mean;   // 特征标准化均值，为空表示未设置
+        std::vector<double> feature_scale;  // 特征标准化缩放
+        std::vector<float> normalized_ring; // 已标准化的序列，[2*max_sequence_length, TRACE_FEATURE_DIM]
+        int ring_write = 0;                 // 下一帧写入的行，取值[0, max_sequence_length)
+        std::vector<float> figure_probs;    // 当前图像的识别概率缓存，为空表示未缓存
             
         void compute_smooth_features(int smooth_window,
-            const xt::xarray<double>& filter_v_target,
-            const xt::xarray<double>& filter_a_target,
-            xt::xarray<double>& smooth_stdv,
-            xt::xarray<double>& smooth_meanv,
-            xt::xarray<double>& smooth_stda,
-            xt::xarray<double>& smooth_meana);
-            
-        void compute_curvature_features(
-            const xt::xarray<double>& smooth_meanv,
-            const xt::xarray<double>& smooth_meana,
-            const xt::xarray<double>& smooth_stdv,
-            const xt::xarray<double>& smooth_stda,
-            std::vector<double>& features);
+            int offset,
+            Vec3& smooth_stdv,
+            Vec3& smooth_meanv,
+            Vec3& smooth_stda,
+            Vec3& smooth_meana) const;
             
-        void compute_similarity_features(
-            const xt::xarray<double>& smooth_meanv,
-            const xt::xarray<double>& smooth_meana,
-            const xt::xarray<double>& smooth_stdv,
-            const xt::xarray<double>& smooth_stda,
-            std::vector<double>& features);
-            
-        void compute_angle_features(
-            const xt::xarray<double>& filter_x_target,
-            const xt::xarray<double>& filter_v_target,
-            const xt::xarray<double>& filter_a_target,
-            std::vector<double>& features);
-
         /**
          * 计算单个时间步的特征
          * @param time_step 时间步索引
@@ -68,21 +92,49 @@ class Feature_Store
             int smooth_window
         );
 
+        Vec3 copy_row(TrackChannel channel, int index) const;
+
+        /**
+         * 用新写入的目标系速度、加速度更新滑动窗口统计
+         * @param leaving_v 离开窗口的速度行
+         * @param leaving_a 离开窗口的加速度行
+         */
+        void update_smooth_stats(const Vec3& leaving_v, const Vec3& leaving_a);
+
         /**
          * 更新特征序列
          * 当基准向量准备好后，计算并添加新的特征
          */
         void update_sequence_features(int smooth_window = 5);
 
+        /**
+         * 惰性模式下补算序列中尚未计算的时刻，已计算的条目保留复用
+         */
+        void materialize_sequence_features();
+
+        /**
+         * 标准化一帧特征并写入双映射环形缓冲区的第 ring_write 行与第 ring_write+max_sequence_length 行，
+         * 使最近 max_sequence_length 帧始终是一段连续内存
+         */
+        void push_normalized_features(const double* features);
+
     public:
         Feature_Store(
             double deltaT,
             int based_window,
             int cache_length,
-            int max_sequence_length = 10  // 新增参数
+            int max_sequence_length = 10,  // 新增参数
+            int smooth_window = 5,         // 平滑窗口，增量统计按此窗口维护
+            bool lazy_sequence = false     // 惰性模式：更新时不计算特征，查询序列时再计算
         );
         ~Feature_Store();
 
+        /**
+         * 清空航迹、图像与特征序列，回到刚构造时的状态
+         * 构造参数与标准化参数保持不变，已分配的内存保留复用，供对象池回收目标时使用
+         */
+        void reset();
+
         void update(
             double Observe_x, double Observe_y, double Observe_z,
             double Filter_P_x, double Filter_P_y, double Filter_P_z,
@@ -90,46 +142,159 @@ class Feature_Store
             double Filter_a_x, double Filter_a_y, double Filter_a_z
         );
 
+        /**
+         * 按顺序写入一段连续量测，结果与逐个调用update一致
+         * 只有最后 max_sequence_length 次更新产生的序列特征会保留，之前的不再计算
+         * 各量测的target_id不使用
+         */
+        void update_bulk(const TraceMeasurement* measurements, int count);
+
+        /**
+         * 预取下一次更新要访问的航迹槽位，供批量更新时隐藏访存延迟
+         */
+        void prefetch_update() const;
+
+        /**
+         * 只更新航迹历史与平滑统计，不计算特征序列，供批量特征引擎使用
+         * @return 本时刻是否应追加一帧序列特征（惰性模式下始终为false）
+         */
+        bool update_track(
+            double Observe_x, double Observe_y, double Observe_z,
+            double Filter_P_x, double Filter_P_y, double Filter_P_z,
+            double Filter_V_x, double Filter_V_y, double Filter_V_z,
+            double Filter_a_x, double Filter_a_y, double Filter_a_z
+        );
+
+        /**
+         * 将外部算好的最新时刻特征追加到特征序列
+         * @param features TRACE_FEATURE_DIM个元素
+         */
+        void push_sequence_features(const double* features);
+
         bool is_track_initialized() const;
         bool is_image_initialized() const;
         bool is_fully_initialized() const;
 
         // 获取特征向量，使用与Python相同的特征构建逻辑
+        // smooth_window与构造时的平滑窗口一致时直接读取增量统计，否则按窗口重新计算
         std::vector<double> get_trace_features(int smooth_window = 5);
 
+        /**
+         * 将最新时刻的特征写入调用方提供的缓冲区，不分配内存
+         * @param features 至少TRACE_FEATURE_DIM个元素
+         */
+        void get_trace_features(double* features, int smooth_window = 5);
+
+        /**
+         * 收集指定时刻计算特征所需的输入
+         * @param time_step 时间步索引，0为最新
+         */
+        TraceFeatureInput get_trace_input(int smooth_window = 5, int time_step = 0) const;
+
+        /**
+         * 单遍计算37维特征，每个向量的模只计算一次，结果与逐项调用
+         * Curvature/Similarity/CalAzimuth/CalElevation 逐位一致
+         * 特征顺序：目标系位置/速度/加速度(9)，速度标准差/均值、加速度标准差/均值(12)，
+         * 曲率(5)，相似度(5)，方位角(3)，仰角(3)
+         * @param features 至少TRACE_FEATURE_DIM个元素
+         */
+        static void compute_trace_features(const TraceFeatureInput& input, double* features);
+
         // 基础计算函数
         double Dif(double value1, double value2, int window, double deltaT);
-        double Modu(const xt::xarray<double>& row_vector);
-        double CalElevation(const xt::xarray<double>& row_vector);
-        double CalAzimuth(const xt::xarray<double>& row_vector);
-        double Similarity(const xt::xarray<double>& row_vector1, const xt::xarray<double>& row_vector2);
-        double Curvature(const xt::xarray<double>& rowVel, const xt::xarray<double>& rowAcc);
-
-        // 向量操作函数
-        xt::xarray<double> Mul(const xt::xarray<double>& row_vector, double multi_rate);
-        xt::xarray<double> Add(const xt::xarray<double>& row_vector1, const xt::xarray<double>& row_vector2);
-        xt::xarray<double> Sub(const xt::xarray<double>& row_vector1, const xt::xarray<double>& row_vector2);
-        xt::xarray<double> Dif(const xt::xarray<double>& matrix, int window,double deltaT);
-        xt::xarray<double> Smooth_Mean(const xt::xarray<double>& matrix, int window);
-        xt::xarray<double> Smooth_Std(const xt::xarray<double>& matrix, int window);
-        xt::xarray<double> Real2Target(const xt::xarray<double>& real_row_vector, const xt::xarray<double>& base_row_vector);
-        xt::xarray<double> Target2Real(const xt::xarray<double>& target_row_vector, const xt::xarray<double>& base_row_vector);
-
-        // 图像数据相关函数
+        static double Modu(RowView row_vector);
+        static double CalElevation(RowView row_vector);
+        static double CalAzimuth(RowView row_vector);
+        static double Similarity(RowView row_vector1, RowView row_vector2);
+        static double Curvature(RowView rowVel, RowView rowAcc);
+
+        // 向量操作函数，参数为行视图，结果以栈上Vec3返回
+        Vec3 Mul(RowView row_vector, double multi_rate);
+        Vec3 Add(RowView row_vector1, RowView row_vector2);
+        Vec3 Sub(RowView row_vector1, RowView row_vector2);
+        // 窗口统计函数作用于历史缓存，offset为窗口起始行（0为最新）
+        Vec3 Dif(const TrackHistory& history, TrackChannel channel, int window, double deltaT, int offset = 0);
+        Vec3 Smooth_Mean(const TrackHistory& history, TrackChannel channel, int window, int offset = 0) const;
+        Vec3 Smooth_Std(const TrackHistory& history, TrackChannel channel, int window, int offset = 0) const;
+        Vec3 Real2Target(RowView real_row_vector, RowView base_row_vector);
+        Vec3 Target2Real(RowView target_row_vector, RowView base_row_vector);
+
+        /**
+         * 获取最新基准向量确定的目标坐标系，可用于目标系与真实系的相互转换
+         * 基准窗口未满前为单位变换
+         */
+        const TargetFrame& get_target_frame() const { return target_frame; }
+
+        // 构造时确定的平滑窗口，增量统计按该窗口维护
+        int get_smooth_window() const { return smooth_window; }
+
+        /**
+         * 图像数据相关函数，更新图像会清除识别概率缓存
+         * const引用版本复制一份图像；右值版本接管图像；ImageBuffer版本共享图像，不复制
+         * @throws std::runtime_error 如果ImageBuffer为空
+         */
         void update_image(const std::vector<unsigned char>& new_image_data);
+        void update_image(std::vector<unsigned char>&& new_image_data);
+        void update_image(ImageBuffer new_image_data);
         const std::vector<unsigned char>& get_image_data() const;
 
+        // 持有的图像缓冲区，未持有时为空
+        const ImageBuffer& get_image_buffer() const { return image_data; }
+
+        // 是否仍持有原始图像；图像被释放而概率缓存保留时，is_image_initialized仍为true
+        bool has_image_data() const { return image_data && !image_data->empty(); }
+
+        // 原始图像占用的字节数；共享的缓冲区在每个持有者处都计入
+        size_t image_bytes() const { return image_data ? image_data->capacity() : 0; }
+
+        /**
+         * 释放原始图像的内存
+         * 已缓存当前图像的识别概率时以缓存代替图像，图像状态不变；否则图像回到未初始化状态
+         * @return 释放的字节数
+         */
+        size_t release_image();
+
+        // 当前图像的识别概率缓存
+        void set_figure_probs(const std::vector<float>& probs) { figure_probs = probs; }
+        bool has_figure_probs() const { return !figure_probs.empty(); }
+        const std::vector<float>& get_figure_probs() const { return figure_probs; }
+
+        // 本对象占用的内存字节数（对象本身、航迹缓存、序列与图像），用于估算主机容量
+        size_t memory_usage() const;
+
         /**
          * 获取特征序列
+         * 惰性模式下先补算自上次查询以来的新时刻，其余条目直接复用
          * @return 当前的特征序列
          * @throws std::runtime_error 如果序列未准备就绪
          */
-        const std::deque<std::vector<double>>& get_trace_features_sequence() const {
-            if (!sequence_ready) {
-                throw std::runtime_error("Feature sequence not ready");
-            }
-            return sequence_features;
-        }
+        const std::deque<std::vector<double>>& get_trace_features_sequence();
+
+        bool is_lazy_sequence() const { return lazy_sequence; }
+        int get_max_sequence_length() const { return max_sequence_length; }
+
+        /**
+         * 设置特征标准化参数 (x - mean) / scale，之后每帧特征在入序列时即标准化为float32
+         * 已有的序列条目会立即补做标准化
+         * @throws std::runtime_error 如果参数长度不是TRACE_FEATURE_DIM
+         */
+        void set_feature_normalization(const std::vector<double>& mean, const std::vector<double>& scale);
+
+        bool has_feature_normalization() const { return !feature_mean.empty(); }
+
+        /**
+         * 获取已标准化的特征序列，最旧的一帧在前
+         * 返回的指针指向连续的 [max_sequence_length, TRACE_FEATURE_DIM] float32 数据，
+         * 可直接包装为张量，在下一次更新或查询之前有效
+         * @throws std::runtime_error 如果序列未就绪或未设置标准化参数
+         */
+        const float* get_normalized_sequence();
+
+        /**
+         * 只读版本，供持有读锁的访问者使用；惰性模式下序列在查询时才计算，须使用非const版本
+         * @throws std::runtime_error 如果为惰性模式、序列未就绪或未设置标准化参数
+         */
+        const float* get_normalized_sequence() const;
 
         /**
          * 检查特征序列是否准备就绪
@@ -0,0 +1,58 @@
+#include "sliding_stats.h"
+#include <math.h>
+
+SlidingWindowStats::SlidingWindowStats(int window)
+    : window(window)
+{
+}
+
+void SlidingWindowStats::update(RowView incoming, RowView outgoing)
+{
+    for (int j = 0; j < 3; j++)
+    {
+        double delta = incoming[j] - outgoing[j];
+        double old_mean = this->mean_[j];
+        this->mean_[j] = old_mean + delta / this->window;
+        this->m2_[j] += delta * (incoming[j] - this->mean_[j] + outgoing[j] - old_mean);
+    }
+    this->updates_since_resync = this->updates_since_resync + 1;
+}
+
+void SlidingWindowStats::resync(const TrackHistory& history, TrackChannel channel)
+{
+    for (int j = 0; j < 3; j++)
+    {
+        double sum = 0.0;
+        for (int i = 0; i < this->window; i++)
+        {
+            sum += history.row(channel, i)[j];
+        }
+        double mean = sum / this->window;
+        double m2 = 0.0;
+        for (int i = 0; i < this->window; i++)
+        {
+            double d = history.row(channel, i)[j] - mean;
+            m2 += d * d;
+        }
+        this->mean_[j] = mean;
+        this->m2_[j] = m2;
+    }
+    this->updates_since_resync = 0;
+}
+
+Vec3 SlidingWindowStats::mean() const
+{
+    return Vec3(this->mean_[0], this->mean_[1], this->mean_[2]);
+}
+
+Vec3 SlidingWindowStats::stddev() const
+{
+    Vec3 result;
+    for (int j = 0; j < 3; j++)
+    {
+        // 舍入可能使离差平方和略小于0
+        double m2 = this->m2_[j] > 0.0 ? this->m2_[j] : 0.0;
+        result[j] = sqrt(m2 / this->window);
+    }
+    return result;
+}
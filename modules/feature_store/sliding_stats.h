@@ -0,0 +1,47 @@
+#ifndef SLIDING_STATS_H
+#define SLIDING_STATS_H
+#include "track_history.h"
+
+/**
+ * 定长滑动窗口的逐列均值与总体标准差（ddof=0，与xt::stddev及Python端一致）
+ * 每次更新加入新行、移除离开窗口的行，采用滑动窗口形式的Welford递推，开销O(1)
+ * 为抑制长时间递推的舍入误差累积，每 RESYNC_INTERVAL 次更新从历史缓存精确重算一次
+ * 与两遍法直接计算的差异：均值约1e-12相对误差，
+ * 标准差绝对误差不超过 1e-6 * max(1, |均值|)
+ */
+class SlidingWindowStats
+{
+  public:
+    static constexpr int RESYNC_INTERVAL = 256;
+
+  private:
+    int window;
+    int updates_since_resync = 0;
+    double mean_[3] = {0.0, 0.0, 0.0};
+    double m2_[3] = {0.0, 0.0, 0.0};   // 窗口内离差平方和
+
+  public:
+    explicit SlidingWindowStats(int window);
+
+    /**
+     * 加入新行并移除离开窗口的行
+     * @param incoming 新进入窗口的行
+     * @param outgoing 离开窗口的行（窗口未满时为缓存中的初始零行）
+     */
+    void update(RowView incoming, RowView outgoing);
+
+    /**
+     * 是否到达精确重算的周期
+     */
+    bool needs_resync() const { return updates_since_resync >= RESYNC_INTERVAL; }
+
+    /**
+     * 从历史缓存最新的window行精确重算
+     */
+    void resync(const TrackHistory& history, TrackChannel channel);
+
+    int size() const { return window; }
+    Vec3 mean() const;
+    Vec3 stddev() const;
+};
+#endif
@@ -0,0 +1,80 @@
+#include "target_frame.h"
+#include "feature_store.h"
+
+TargetFrame::TargetFrame()
+    : rotation{{1.0, 0.0, 0.0}, {0.0, 1.0, 0.0}, {0.0, 0.0, 1.0}}
+{
+}
+
+TargetFrame::TargetFrame(RowView base_row_vector)
+{
+  double x = base_row_vector[0];
+  double y = base_row_vector[1];
+  double h = base_row_vector[2];
+
+  // 方位角 beta_h：分量在EPSILON以内按0处理，两者都为0时方位角为0
+  double ax = ((x<EPSILON)&&(x>-EPSILON)) ? 0.0 : x;
+  double ay = ((y<EPSILON)&&(y>-EPSILON)) ? 0.0 : y;
+  double cos_h = 1.0;
+  double sin_h = 0.0;
+  if ((ax != 0.0) || (ay != 0.0))
+  {
+    double r = sqrt(ax*ax+ay*ay);
+    cos_h = ax/r;
+    sin_h = ay/r;
+  }
+
+  // 仰角 beta_l：水平距离在EPSILON以内时为0或正负1500密位
+  double R = sqrt(x*x+y*y);
+  double cos_l = 1.0;
+  double sin_l = 0.0;
+  if ((R<EPSILON)&&(R>-EPSILON))
+  {
+    if (h>=EPSILON)
+    {
+      cos_l = 0.0;
+      sin_l = 1.0;
+    }
+    else if (h<=-EPSILON)
+    {
+      cos_l = 0.0;
+      sin_l = -1.0;
+    }
+  }
+  else
+  {
+    double norm = sqrt(R*R+h*h);
+    cos_l = R/norm;
+    sin_l = h/norm;
+  }
+
+  this->rotation[0][0] = cos_h*cos_l;
+  this->rotation[0][1] = sin_h*cos_l;
+  this->rotation[0][2] = sin_l;
+  this->rotation[1][0] = -sin_h;
+  this->rotation[1][1] = cos_h;
+  this->rotation[1][2] = 0.0;
+  this->rotation[2][0] = -cos_h*sin_l;
+  this->rotation[2][1] = -sin_h*sin_l;
+  this->rotation[2][2] = cos_l;
+}
+
+Vec3 TargetFrame::to_target(RowView real_row_vector) const
+{
+  const double (*m)[3] = this->rotation;
+  return Vec3(
+    m[0][0]*real_row_vector[0]+m[0][1]*real_row_vector[1]+m[0][2]*real_row_vector[2],
+    m[1][0]*real_row_vector[0]+m[1][1]*real_row_vector[1]+m[1][2]*real_row_vector[2],
+    m[2][0]*real_row_vector[0]+m[2][1]*real_row_vector[1]+m[2][2]*real_row_vector[2]
+  );
+}
+
+Vec3 TargetFrame::to_real(RowView target_row_vector) const
+{
+  const double (*m)[3] = this->rotation;
+  return Vec3(
+    m[0][0]*target_row_vector[0]+m[1][0]*target_row_vector[1]+m[2][0]*target_row_vector[2],
+    m[0][1]*target_row_vector[0]+m[1][1]*target_row_vector[1]+m[2][1]*target_row_vector[2],
+    m[0][2]*target_row_vector[0]+m[1][2]*target_row_vector[1]+m[2][2]*target_row_vector[2]
+  );
+}
@@ -0,0 +1,24 @@
+#ifndef TARGET_FRAME_H
+#define TARGET_FRAME_H
+#include "batch_vector.h"
+
+/**
+ * 由基准向量确定的目标坐标系
+ * 构造时计算一次真实系到目标系的旋转矩阵，之后每次转换只是一次3x3矩阵向量乘法
+ * 旋转矩阵直接由基准向量分量归一化得到，不调用三角函数，
+ * 方位角、仰角的零值与EPSILON判定约定与CalAzimuth/CalElevation一致；
+ * 与三角函数写法的差异约1e-12，来源于RADTOMIL常数的截断
+ */
+class TargetFrame
+{
+  private:
+    double rotation[3][3];   // 真实系 -> 目标系，目标系 -> 真实系为其转置
+
+  public:
+    TargetFrame();
+    explicit TargetFrame(RowView base_row_vector);
+
+    Vec3 to_target(RowView real_row_vector) const;
+    Vec3 to_real(RowView target_row_vector) const;
+};
+#endif
@@ -0,0 +1,62 @@
+#include "track_history.h"
+#include <algorithm>
+#include <new>
+
+TrackHistory::TrackHistory(int length)
+    : length(length)
+{
+    std::size_t count = static_cast<std::size_t>(length) * SLOT_STRIDE;
+    this->slab = static_cast<double*>(
+        ::operator new[](count * sizeof(double), std::align_val_t(ALIGNMENT))
+    );
+    std::fill(this->slab, this->slab + count, 0.0);
+}
+
+TrackHistory::~TrackHistory()
+{
+    ::operator delete[](this->slab, std::align_val_t(ALIGNMENT));
+}
+
+void TrackHistory::reset()
+{
+    std::fill(this->slab, this->slab + static_cast<std::size_t>(this->length) * SLOT_STRIDE, 0.0);
+    this->head = 0;
+    this->raw_steps = 0;
+    this->derived_steps = 0;
+}
+
+void TrackHistory::advance()
+{
+    this->head = (this->head + this->length - 1) % this->length;
+    this->raw_steps = this->raw_steps + 1;
+    double* slot = this->slab + this->head * SLOT_STRIDE;
+    std::fill(slot + BASE_VECTOR * 3, slot + SLOT_STRIDE, 0.0);
+}
+
+void TrackHistory::set(TrackChannel channel, double x, double y, double z)
+{
+    double* dst = this->slab + this->head * SLOT_STRIDE + channel * 3;
+    dst[0] = x;
+    dst[1] = y;
+    dst[2] = z;
+}
+
+void TrackHistory::set(TrackChannel channel, RowView value)
+{
+    this->set(channel, value[0], value[1], value[2]);
+}
+
+void TrackHistory::mark_derived()
+{
+    this->derived_steps = this->derived_steps + 1;
+}
+
+RowView TrackHistory::row(TrackChannel channel, int index) const
+{
+    return RowView(this->slab + this->physical_slot(index) * SLOT_STRIDE + channel * 3);
+}
+
+ColView TrackHistory::col(TrackChannel channel, int axis) const
+{
+    return ColView{this->slab + channel * 3 + axis, this->length, this->head, SLOT_STRIDE};
+}
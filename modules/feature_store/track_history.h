@@ -0,0 +1,93 @@
+#ifndef TRACK_HISTORY_H
+#define TRACK_HISTORY_H
+#include <cstddef>
+#include "batch_vector.h"
+
+// 航迹历史中的各个通道，每个通道每个时刻为一个三维向量
+enum TrackChannel
+{
+    OBSERVE = 0,        // 观测数据
+    FILTER_P,           // 滤波位置
+    FILTER_V,           // 滤波速度
+    FILTER_A,           // 滤波加速度
+    BASE_VECTOR,        // 基准向量
+    FILTER_X_TARGET,    // 目标系位置
+    FILTER_V_TARGET,    // 目标系速度
+    FILTER_A_TARGET,    // 目标系加速度
+    TRACK_CHANNEL_COUNT
+};
+
+/**
+ * 单个目标全部航迹历史的环形缓存
+ * 所有通道存放在同一块按缓存行对齐的内存中，共用一个head
+ * 每个环形槽位依次存放8个通道的三维向量（24个double，正好3个缓存行），
+ * 一次更新只移动一次head，并且只写入一个连续槽位
+ * 衍生通道（基准向量及目标系向量）在基准窗口未满前保持为0
+ */
+class TrackHistory
+{
+  public:
+    static constexpr int SLOT_STRIDE = TRACK_CHANNEL_COUNT * 3;
+    static constexpr std::size_t ALIGNMENT = 64;
+
+  private:
+    double* slab = nullptr;   // [length, TRACK_CHANNEL_COUNT, 3]
+    int length = 0;
+    int head = 0;             // 最新槽位
+    int raw_steps = 0;        // 原始通道的更新次数
+    int derived_steps = 0;    // 衍生通道的更新次数
+
+    int physical_slot(int index) const { return (head + index) % length; }
+
+  public:
+    explicit TrackHistory(int length);
+    ~TrackHistory();
+    TrackHistory(const TrackHistory&) = delete;
+    TrackHistory& operator=(const TrackHistory&) = delete;
+
+    /**
+     * 清空全部历史，回到刚构造时的状态，保留已分配的内存
+     */
+    void reset();
+
+    /**
+     * 前移head，开始一个新的时刻
+     * 新槽位的衍生通道清零，原始通道由调用方随后写入
+     */
+    void advance();
+
+    /**
+     * 写入最新时刻某个通道的值
+     */
+    void set(TrackChannel channel, double x, double y, double z);
+    void set(TrackChannel channel, RowView value);
+
+    /**
+     * 标记最新时刻的衍生通道已写入
+     */
+    void mark_derived();
+
+    /**
+     * 预取下一次advance将写入的槽位（3个缓存行）
+     */
+    void prefetch_next_slot() const
+    {
+#if defined(__GNUC__)
+        const double* slot = this->slab + ((this->head + this->length - 1) % this->length) * SLOT_STRIDE;
+        __builtin_prefetch(slot, 1);
+        __builtin_prefetch(slot + 8, 1);
+        __builtin_prefetch(slot + 16, 1);
+#endif
+    }
+
+    RowView row(TrackChannel channel, int index) const;
+    ColView col(TrackChannel channel, int axis) const;
+
+    int size() const { return length; }
+    int clock_step() const { return raw_steps; }
+    int derived_step() const { return derived_steps; }
+
+    // 与原先每个BatchVector的is_initialized语义一致：所有通道都已写满一轮
+    bool is_initialized() const { return derived_steps > length; }
+};
+#endif
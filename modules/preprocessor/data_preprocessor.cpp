@@ -1,261 +1,196 @@
 #include "data_preprocessor.h"
+#include "image_kernels.h"
 #include <xtensor/xnpy.hpp>
+#include <algorithm>
 #include <stdexcept>
 #include <torch/torch.h>
 #include <opencv2/opencv.hpp>
 #include <vector>
-#include <iostream>
 
-ImagePreprocessor::ImagePreprocessor(int target_size, int crop_size) 
+ImagePreprocessor::ImagePreprocessor(int target_size, int crop_size, PreprocessMode mode) 
     : target_size_(target_size),
       crop_size_(crop_size),
-      is_initialized_(true) {
+      is_initialized_(true),
+      mode_(mode),
+      scaled_decode_(false) {
     // 初始化ImageNet标准化参数
-    mean_ = torch::tensor({0.485, 0.456, 0.406}).view({3, 1, 1});
-    std_ = torch::tensor({0.229, 0.224, 0.225}).view({3, 1, 1});
+    const float mean[3] = {0.485f, 0.456f, 0.406f};
+    const float std_dev[3] = {0.229f, 0.224f, 0.225f};
+    unit_normalize_ = make_normalize_params(mean, std_dev, 1.0f);
+    byte_normalize_ = make_normalize_params(mean, std_dev, 255.0f);
 }
 
-void print_sample_pixels(const cv::Mat& img, const std::string& step_name) {
-    std::cout << "\n" << step_name << " sample pixels:" << std::endl;
-    if (img.channels() == 3) {
-        cv::Vec3b top_left = img.at<cv::Vec3b>(0, 0);
-        cv::Vec3b center = img.at<cv::Vec3b>(img.rows/2, img.cols/2);
-        cv::Vec3b bottom_right = img.at<cv::Vec3b>(img.rows-1, img.cols-1);
-        
-        std::cout << "Top-left (0,0): RGB=["
-                  << (int)top_left[0] << "," << (int)top_left[1] << "," << (int)top_left[2] << "]" << std::endl;
-        std::cout << "Center (" << img.rows/2 << "," << img.cols/2 << "): RGB=["
-                  << (int)center[0] << "," << (int)center[1] << "," << (int)center[2] << "]" << std::endl;
-        std::cout << "Bottom-right (" << img.rows-1 << "," << img.cols-1 << "): RGB=["
-                  << (int)bottom_right[0] << "," << (int)bottom_right[1] << "," << (int)bottom_right[2] << "]" << std::endl;
-    }
+torch::Tensor ImagePreprocessor::preprocess(const std::vector<unsigned char >& image_data) const {
+    return preprocess(image_data.data(), image_data.size());
 }
 
-void print_sample_pixels_float(const cv::Mat& img, const std::string& step_name) {
-    std::cout << "\n" << step_name << " sample pixels:" << std::endl;
-    if (img.channels() == 3) {
-        cv::Vec3f top_left = img.at<cv::Vec3f>(0, 0);
-        cv::Vec3f center = img.at<cv::Vec3f>(img.rows/2, img.cols/2);
-        cv::Vec3f bottom_right = img.at<cv::Vec3f>(img.rows-1, img.cols-1);
-        
-        std::cout << "Top-left (0,0): RGB=["
-                  << top_left[0] << "," << top_left[1] << "," << top_left[2] << "]" << std::endl;
-        std::cout << "Center (" << img.rows/2 << "," << img.cols/2 << "): RGB=["
-                  << center[0] << "," << center[1] << "," << center[2] << "]" << std::endl;
-        std::cout << "Bottom-right (" << img.rows-1 << "," << img.cols-1 << "): RGB=["
-                  << bottom_right[0] << "," << bottom_right[1] << "," << bottom_right[2] << "]" << std::endl;
+// 记录解码后的8位BGR图像，样本像素按RGB顺序记录
+static void record_image_stage(PreprocessReport& report, const cv::Mat& img, const std::string& stage) {
+    PreprocessStageStats stats;
+    stats.stage = stage;
+    stats.shape = {img.rows, img.cols, img.channels()};
+    double min_value, max_value;
+    cv::minMaxLoc(img.reshape(1), &min_value, &max_value);
+    stats.min = static_cast<float>(min_value);
+    stats.max = static_cast<float>(max_value);
+    const cv::Point points[3] = {{0, 0}, {img.cols / 2, img.rows / 2}, {img.cols - 1, img.rows - 1}};
+    for (int p = 0; p < 3; ++p) {
+        cv::Vec3b pixel = img.at<cv::Vec3b>(points[p]);
+        for (int c = 0; c < 3; ++c) {
+            stats.samples[p][c] = pixel[2 - c];
+        }
     }
+    report.stages.push_back(stats);
 }
 
-void print_tensor_sample_pixels(const torch::Tensor& tensor, const std::string& step_name) {
-    std::cout << "\n" << step_name << " sample pixels:" << std::endl;
-    auto t = tensor.squeeze();  // Remove batch dimension if present
-    if (t.dim() == 3) {  // CHW format
-        std::cout << "Top-left (0,0): RGB=["
-                  << t[0][0][0].item<float>() << "," 
-                  << t[1][0][0].item<float>() << "," 
-                  << t[2][0][0].item<float>() << "]" << std::endl;
-        
-        std::cout << "Center (112,112): RGB=["
-                  << t[0][112][112].item<float>() << "," 
-                  << t[1][112][112].item<float>() << "," 
-                  << t[2][112][112].item<float>() << "]" << std::endl;
-        
-        std::cout << "Bottom-right (223,223): RGB=["
-                  << t[0][223][223].item<float>() << "," 
-                  << t[1][223][223].item<float>() << "," 
-                  << t[2][223][223].item<float>() << "]" << std::endl;
+// 记录 [C,H,W] 或 [1,C,H,W] 的float张量
+static void record_tensor_stage(PreprocessReport& report, const torch::Tensor& tensor, const std::string& stage) {
+    PreprocessStageStats stats;
+    stats.stage = stage;
+    stats.shape.assign(tensor.sizes().begin(), tensor.sizes().end());
+    stats.min = tensor.min().item<float>();
+    stats.max = tensor.max().item<float>();
+    auto chw = tensor.dim() == 4 ? tensor.squeeze(0) : tensor;
+    int64_t h = chw.size(1);
+    int64_t w = chw.size(2);
+    const int64_t points[3][2] = {{0, 0}, {h / 2, w / 2}, {h - 1, w - 1}};
+    for (int p = 0; p < 3; ++p) {
+        for (int c = 0; c < 3; ++c) {
+            stats.samples[p][c] = chw[c][points[p][0]][points[p][1]].item<float>();
+        }
     }
+    report.stages.push_back(stats);
 }
 
-cv::Mat ImagePreprocessor::decode_image(const std::vector<unsigned char >& image_data) const {
-    cv::Mat img = cv::imdecode(image_data, cv::IMREAD_COLOR);
-    if (img.empty()) {
-        throw std::runtime_error("Failed to decode image data.");
-    }
-    std::cout << "\nC++ preprocessing steps:" << std::endl;
-    std::cout << "1. Original image size: " << img.size() << ", channels: " << img.channels() 
-              << ", type: " << img.type() << std::endl;
-    print_sample_pixels(img, "1. Original image");
-    
-    // 将图像从BGR转换为RGB
-    cv::cvtColor(img, img, cv::COLOR_BGR2RGB);
-    print_sample_pixels(img, "1b. After BGR->RGB conversion");
-    return img;
+torch::Tensor ImagePreprocessor::preprocess(const unsigned char* data, size_t size) const {
+    torch::Tensor tensor = torch::empty({1, 3, crop_size_, crop_size_}, torch::kFloat32);
+    preprocess_into(data, size, tensor.data_ptr<float>());
+    return tensor;
 }
 
-cv::Mat ImagePreprocessor::resize_image(const cv::Mat& img) const {
-    int h = img.rows;
-    int w = img.cols;
-    
-    // 计算输出尺寸
-    // 遵循PyTorch的_compute_resized_output_size逻辑
-    int new_h, new_w;
-    if (w <= h) {
-        // 宽度是较短边
-        new_w = target_size_;
-        new_h = static_cast<int>(std::round(static_cast<float>(target_size_) * h / w));
-    } else {
-        // 高度是较短边
-        new_h = target_size_;
-        new_w = static_cast<int>(std::round(static_cast<float>(target_size_) * w / h));
+void ImagePreprocessor::preprocess_into(const unsigned char* data, size_t size, float* out) const {
+#if PREPROCESS_ENABLE_DIAGNOSTICS
+    if (mode_ == PREPROCESS_DIAGNOSTIC) {
+        PreprocessReport report;
+        run_pipeline(data, size, out, &report);
+        std::lock_guard<std::mutex> lock(report_mutex_);
+        last_report_ = std::move(report);
+        return;
     }
+#endif
+    run_pipeline(data, size, out, nullptr);
+}
 
-    std::cout << "\nResize calculation details:" << std::endl;
-    std::cout << "Original size: [" << h << " x " << w << "]" << std::endl;
-    std::cout << "Target size (shorter edge): " << target_size_ << std::endl;
-    std::cout << "Calculated new size: [" << new_h << " x " << new_w << "]" << std::endl;
-
-    // 1. 将OpenCV Mat转换为torch tensor (HWC -> NCHW)
-    auto tensor_image = torch::from_blob(
-        img.data,
-        {1, 3, h, w},  // NCHW格式
-        torch::kUInt8
-    ).clone();
-    
-    // 2. 转换为float32并归一化到[0, 1]
-    tensor_image = tensor_image.to(torch::kFloat32) / 255.0;
-    
-    // 3. 使用torch的interpolate进行resize
-    // 注意：PyTorch的interpolate期望输入是NCHW格式，范围[0, 1]
-    auto resized_tensor = torch::nn::functional::interpolate(
-        tensor_image,
-        torch::nn::functional::InterpolateFuncOptions()
-            .size(std::vector<int64_t>{new_h, new_w})
-            .mode(torch::kBilinear)
-            .align_corners(false)
-            .antialias(true)  // 与Python端保持一致
-    );
-    
-    // 4. 转换回uint8范围
-    resized_tensor = (resized_tensor * 255.0)
-                        .round()
-                        .clamp(0, 255)
-                        .to(torch::kUInt8);
-    
-    // 5. 转换回OpenCV Mat格式 (NCHW -> HWC)
-    resized_tensor = resized_tensor.squeeze(0)  // 移除batch维度
-                                 .permute({1, 2, 0});  // CHW -> HWC
-    
-    cv::Mat resized(new_h, new_w, CV_8UC3, resized_tensor.data_ptr());
-    
-    // 打印调试信息
-    std::cout << "2. After resize: [" << resized.size() << "]" << std::endl;
-    print_sample_pixels(resized, "2. After resize");
-    
-    return resized.clone();  // 返回副本以确保内存安全
+torch::Tensor ImagePreprocessor::preprocess_with_report(const unsigned char* data, size_t size, PreprocessReport& report) const {
+    report = PreprocessReport();
+    torch::Tensor tensor = torch::empty({1, 3, crop_size_, crop_size_}, torch::kFloat32);
+    run_pipeline(data, size, tensor.data_ptr<float>(), &report);
+    return tensor;
 }
 
-cv::Mat ImagePreprocessor::center_crop(const cv::Mat& img) const {
-    // 从中心裁剪指定大小的区域
-    int top = (img.rows - crop_size_) / 2;
-    int left = (img.cols - crop_size_) / 2;
-    cv::Rect crop_region(left, top, crop_size_, crop_size_);
-    cv::Mat cropped = img(crop_region).clone();
-    std::cout << "3. After crop: " << cropped.size() << std::endl;
-    print_sample_pixels(cropped, "3. After crop");
-    return cropped;
+PreprocessReport ImagePreprocessor::last_report() const {
+    std::lock_guard<std::mutex> lock(report_mutex_);
+    return last_report_;
 }
 
-torch::Tensor ImagePreprocessor::convert_to_tensor(const cv::Mat& img) const {
-    // 1. 转换为float类型并归一化到[0,1]
-    cv::Mat float_img;
-    img.convertTo(float_img, CV_32FC3, 1.0 / 255.0);
-    print_sample_pixels_float(float_img, "4. After convert to float");
-    
-    // 获取图像的最小最大值（分通道）
-    std::vector<cv::Mat> channels;
-    cv::split(float_img, channels);
-    std::cout << "4. After convert to float (per channel):" << std::endl;
-    for (int i = 0; i < channels.size(); ++i) {
-        double minVal, maxVal;
-        cv::minMaxLoc(channels[i], &minVal, &maxVal);
-        std::cout << "   Channel " << i << ": [" << minVal << ", " << maxVal << "]" << std::endl;
+// 从JPEG帧头读取原始尺寸，不是JPEG或帧头不完整时返回false
+static bool read_jpeg_size(const unsigned char* data, size_t size, int& height, int& width) {
+    if (size < 4 || data[0] != 0xFF || data[1] != 0xD8) {
+        return false;
     }
+    size_t pos = 2;
+    while (pos + 4 <= size) {
+        if (data[pos] != 0xFF) {
+            return false;
+        }
+        unsigned char marker = data[pos + 1];
+        if (marker == 0xFF) {   // 填充字节
+            ++pos;
+            continue;
+        }
+        pos += 2;
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) {   // 无长度的标记
+            continue;
+        }
+        if (marker == 0xD9 || marker == 0xDA) {   // 图像数据之前没有帧头
+            return false;
+        }
+        size_t length = (static_cast<size_t>(data[pos]) << 8) | data[pos + 1];
+        if (length < 2 || pos + length > size) {
+            return false;
+        }
+        // SOF0-SOF15，排除DHT、JPG、DAC
+        if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+            if (length < 7) {
+                return false;
+            }
+            height = (data[pos + 3] << 8) | data[pos + 4];
+            width = (data[pos + 5] << 8) | data[pos + 6];
+            return height > 0 && width > 0;
+        }
+        pos += length;
+    }
+    return false;
+}
 
-    // 2. 转换为tensor并调整维度顺序为[C, H, W]
-    auto tensor_image = torch::from_blob(
-        float_img.data, 
-        {crop_size_, crop_size_, 3}, 
-        torch::kFloat32
-    ).clone();
-    
-    // 调整为[C, H, W]格式
-    tensor_image = tensor_image.permute({2, 0, 1});
-    std::cout << "5. After permute: shape=" << tensor_image.sizes() 
-              << ", range=[" << tensor_image.min().item<float>() << ", " 
-              << tensor_image.max().item<float>() << "]" << std::endl;
-    print_tensor_sample_pixels(tensor_image, "5. After permute");
-    
-    // 3. 使用ImageNet均值和标准差进行标准化
-    tensor_image = tensor_image.unsqueeze(0);  // 添加batch维度 [1, C, H, W]
-    std::cout << "6. Before normalization: shape=" << tensor_image.sizes()
-              << ", range=[" << tensor_image.min().item<float>() << ", " 
-              << tensor_image.max().item<float>() << "]" << std::endl;
-    print_tensor_sample_pixels(tensor_image, "6. Before normalization");
-              
-    tensor_image = (tensor_image - mean_) / std_;
-    std::cout << "7. After normalization: shape=" << tensor_image.sizes()
-              << ", range=[" << tensor_image.min().item<float>() << ", " 
-              << tensor_image.max().item<float>() << "]" << std::endl;
-    print_tensor_sample_pixels(tensor_image, "7. After normalization");
-    
-    // 打印每个通道的统计信息
-    for (int i = 0; i < 3; ++i) {
-        auto channel = tensor_image.select(1, i);
-        std::cout << "\nChannel " << i << " statistics:" << std::endl;
-        std::cout << "Mean: " << channel.mean().item<float>() << std::endl;
-        std::cout << "Std: " << channel.std().item<float>() << std::endl;
-        std::cout << "Min: " << channel.min().item<float>() << std::endl;
-        std::cout << "Max: " << channel.max().item<float>() << std::endl;
-        std::cout << "First 5 values: ";
-        for (int j = 0; j < 5; ++j) {
-            std::cout << channel[0][0][j].item<float>() << " ";
+int ImagePreprocessor::decode_reduction(int height, int width) const {
+    if (!scaled_decode()) {
+        return 1;
+    }
+    // 缩小解码的尺寸向上取整
+    int short_side = std::min(height, width);
+    for (int factor : {8, 4, 2}) {
+        if ((short_side + factor - 1) / factor >= target_size_) {
+            return factor;
         }
-        std::cout << std::endl;
     }
-    
-    return tensor_image;
+    return 1;
 }
 
-torch::Tensor ImagePreprocessor::preprocess(const std::vector<unsigned char >& image_data) const {
+void ImagePreprocessor::run_pipeline(const unsigned char* data, size_t size, float* out, PreprocessReport* report) const {
     if (!is_initialized_) {
         throw std::runtime_error("Image preprocessor not initialized");
     }
+    if (size == 0) {
+        throw std::runtime_error("Failed to decode image data.");
+    }
     
-    // 1. 解码图像
-    cv::Mat img = cv::imdecode(image_data, cv::IMREAD_COLOR);
+    // 1. 解码图像，以Mat头包装调用方的缓冲区；保持BGR，通道顺序在缩放时调整
+    //    开启scaled decode时大尺寸JPEG在DCT域缩小解码
+    int h = 0;
+    int w = 0;
+    int reduction = 1;
+    if (scaled_decode() && read_jpeg_size(data, size, h, w)) {
+        reduction = decode_reduction(h, w);
+    }
+    int flags = cv::IMREAD_COLOR;
+    if (reduction == 2) {
+        flags = cv::IMREAD_REDUCED_COLOR_2;
+    } else if (reduction == 4) {
+        flags = cv::IMREAD_REDUCED_COLOR_4;
+    } else if (reduction == 8) {
+        flags = cv::IMREAD_REDUCED_COLOR_8;
+    }
+    cv::Mat encoded(1, static_cast<int>(size), CV_8UC1, const_cast<unsigned char*>(data));
+    cv::Mat img = cv::imdecode(encoded, flags);
     if (img.empty()) {
         throw std::runtime_error("Failed to decode image data.");
     }
-    
-    // BGR -> RGB
-    cv::cvtColor(img, img, cv::COLOR_BGR2RGB);
-    
-    std::cout << "\nC++ preprocessing steps:" << std::endl;
-    std::cout << "1. Original image: " << img.size() << ", channels: " << img.channels() << std::endl;
-    print_sample_pixels(img, "1. Original image");
-
-    // 2. 转换为float tensor并归一化到[0,1]
-    cv::Mat float_img;
-    img.convertTo(float_img, CV_32FC3, 1.0/255.0);
-    
-    // 转换为tensor [H,W,C] -> [C,H,W]
-    auto tensor = torch::from_blob(
-        float_img.data,
-        {float_img.rows, float_img.cols, 3},
-        torch::kFloat32
-    ).clone();
-    tensor = tensor.permute({2, 0, 1});
-    
-    std::cout << "2. After to_tensor: shape=" << tensor.sizes() 
-              << ", range=[" << tensor.min().item<float>() << ", " 
-              << tensor.max().item<float>() << "]" << std::endl;
-    print_tensor_sample_pixels(tensor, "2. After to_tensor");
+    if (reduction == 1) {
+        h = img.rows;
+        w = img.cols;
+    } else if (img.rows != (h + reduction - 1) / reduction || img.cols != (w + reduction - 1) / reduction) {
+        // 按EXIF方向旋转了90度
+        std::swap(h, w);
+    }
+    if (report) {
+        report->image_height = h;
+        report->image_width = w;
+        report->decode_reduction = reduction;
+        record_image_stage(*report, img, "decode");
+    }
 
-    // 3. Resize
-    int h = tensor.size(1);
-    int w = tensor.size(2);
+    // 2. 缩放后的尺寸，按原始尺寸计算，遵循PyTorch的_compute_resized_output_size逻辑
     int new_h, new_w;
     if (w <= h) {
         new_w = target_size_;
@@ -265,55 +200,53 @@ torch::Tensor ImagePreprocessor::preprocess(const std::vector<unsigned char >& i
         new_w = static_cast<int>(std::round(static_cast<float>(target_size_) * w / h));
     }
 
-    tensor = tensor.unsqueeze(0);  // 添加batch维度用于interpolate
-    tensor = torch::nn::functional::interpolate(
-        tensor,
-        torch::nn::functional::InterpolateFuncOptions()
-            .size(std::vector<int64_t>{new_h, new_w})
-            .mode(torch::kBilinear)
-            .align_corners(false)
-            .antialias(true)
-    );
-    
-    std::cout << "3. After resize: shape=" << tensor.sizes()
-              << ", range=[" << tensor.min().item<float>() << ", " 
-              << tensor.max().item<float>() << "]" << std::endl;
-    print_tensor_sample_pixels(tensor, "3. After resize");
-
-    // 4. Center crop
+    // 3. 只对映射到中心裁剪区域的源像素做抗锯齿缩放，直接读取8位数据，
+    //    等价于ToTensor + Resize(antialias) + CenterCrop
+    //    尺寸不变时缩放是恒等变换，跳过缩放，由第4步直接读取8位裁剪区域
     int crop_top = (new_h - crop_size_) / 2;
     int crop_left = (new_w - crop_size_) / 2;
-    tensor = tensor.slice(2, crop_top, crop_top + crop_size_)
-                  .slice(3, crop_left, crop_left + crop_size_);
-    
-    std::cout << "4. After crop: shape=" << tensor.sizes()
-              << ", range=[" << tensor.min().item<float>() << ", " 
-              << tensor.max().item<float>() << "]" << std::endl;
-    print_tensor_sample_pixels(tensor, "4. After crop");
+    const bool identity = new_h == img.rows && new_w == img.cols;
+    thread_local std::vector<float> cropped;   // [crop, crop, 3]，RGB，取值[0,1]
+    if (!identity || report) {
+        cropped.resize(static_cast<size_t>(crop_size_) * crop_size_ * 3);
+        resize_crop_u8(img.data, img.rows, img.cols, img.step, true,
+                       new_h, new_w, crop_top, crop_left, crop_size_, crop_size_, cropped.data());
+    } else if (crop_top < 0 || crop_left < 0) {
+        throw std::runtime_error("Crop size " + std::to_string(crop_size_) + " exceeds resized image " +
+                                 std::to_string(new_h) + "x" + std::to_string(new_w));
+    }
+    if (report) {
+        auto tensor = torch::from_blob(
+            cropped.data(),
+            {1, crop_size_, crop_size_, 3},
+            torch::kFloat32
+        ).permute({0, 3, 1, 2});
+        record_tensor_stage(*report, tensor, "resize_crop");
+    }
 
-    // 5. Normalize
-    tensor = (tensor - mean_) / std_;
-    
-    std::cout << "5. After normalize: shape=" << tensor.sizes()
-              << ", range=[" << tensor.min().item<float>() << ", " 
-              << tensor.max().item<float>() << "]" << std::endl;
-    print_tensor_sample_pixels(tensor, "5. After normalize");
+    // 4. Normalize与HWC->CHW转换合并为一遍，直接写入out
+    if (identity) {
+        const unsigned char* roi = img.ptr<unsigned char>(crop_top) + static_cast<size_t>(crop_left) * 3;
+        normalize_hwc_u8(roi, crop_size_, crop_size_, img.step, true, byte_normalize_, NORMALIZE_CHW, out);
+    } else {
+        normalize_hwc_f32(cropped.data(), crop_size_, crop_size_, unit_normalize_, NORMALIZE_CHW, out);
+    }
+    if (report) {
+        auto tensor = torch::from_blob(out, {1, 3, crop_size_, crop_size_}, torch::kFloat32);
+        record_tensor_stage(*report, tensor, "normalize");
 
-    // 打印每个通道的统计信息
-    // 确保使用与Python相同的计算方式
-    auto tensor_no_batch = tensor.squeeze(0);  // 移除batch维度
-    for (int i = 0; i < 3; ++i) {
-        auto channel = tensor_no_batch[i];  // 获取单个通道 [H,W]
-        auto channel_flat = channel.flatten();  // 展平为1D tensor以计算统计信息
-        
-        std::cout << "\nChannel " << i << " statistics:" << std::endl;
-        std::cout << "Mean: " << channel_flat.mean().item<float>() << std::endl;
-        std::cout << "Std: " << channel_flat.std(0).item<float>() << std::endl;  // 使用unbiased=False以匹配Python
-        std::cout << "Min: " << channel_flat.min().item<float>() << std::endl;
-        std::cout << "Max: " << channel_flat.max().item<float>() << std::endl;
+        // 每个通道的统计，与Python侧的计算方式一致，std为无偏估计
+        auto tensor_no_batch = tensor.squeeze(0);
+        for (int i = 0; i < 3; ++i) {
+            auto channel_flat = tensor_no_batch[i].flatten();
+            PreprocessChannelStats stats;
+            stats.mean = channel_flat.mean().item<float>();
+            stats.std = channel_flat.std().item<float>();
+            stats.min = channel_flat.min().item<float>();
+            stats.max = channel_flat.max().item<float>();
+            report->channels.push_back(stats);
+        }
     }
-    
-    return tensor;
 }
 
 TracePreprocessor::TracePreprocessor() : is_initialized_(false) {}
@@ -0,0 +1,412 @@
+#include "image_kernels.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define ML_AVX2_KERNEL 1
+#endif
+
+// x86-64 GCC下为自动向量化的循环生成多个指令集版本，由加载器按CPU选择
+#if defined(__GNUC__) && !defined(__clang__) && defined(__x86_64__)
+#define ML_TARGET_CLONES __attribute__((target_clones("avx512f", "avx2", "default")))
+#else
+#define ML_TARGET_CLONES
+#endif
+
+namespace {
+
+// torch双线性抗锯齿使用的三角滤波器
+inline float triangle_filter(float x) {
+    x = std::abs(x);
+    return x < 1.0f ? 1.0f - x : 0.0f;
+}
+
+// uint8 -> [0,1] 的查找表，与ToTensor的除法逐位一致
+const float* unit_scale_table() {
+    static const std::vector<float> table = []() {
+        std::vector<float> values(256);
+        for (int v = 0; v < 256; ++v) {
+            values[v] = static_cast<float>(v) / 255.0f;
+        }
+        return values;
+    }();
+    return table.data();
+}
+
+bool has_avx2() {
+#ifdef ML_AVX2_KERNEL
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+// 水平方向一行的标量实现，求和顺序与torch相同
+void horizontal_row_scalar(const unsigned char* line, const ResampleAxis& axis, int out_count, bool swap_rb, float* out) {
+    const float* unit = unit_scale_table();
+    const int c0 = swap_rb ? 2 : 0;
+    const int c2 = swap_rb ? 0 : 2;
+    for (int x = 0; x < out_count; ++x) {
+        const float* w = &axis.weights[static_cast<size_t>(x) * axis.taps];
+        const unsigned char* p = line + static_cast<size_t>(axis.start[x]) * 3;
+        float r = unit[p[c0]] * w[0];
+        float g = unit[p[1]] * w[0];
+        float b = unit[p[c2]] * w[0];
+        for (int j = 1; j < axis.count[x]; ++j) {
+            const unsigned char* q = p + j * 3;
+            r += unit[q[c0]] * w[j];
+            g += unit[q[1]] * w[j];
+            b += unit[q[c2]] * w[j];
+        }
+        out[x * 3 + 0] = r;
+        out[x * 3 + 1] = g;
+        out[x * 3 + 2] = b;
+    }
+}
+
+#ifdef ML_AVX2_KERNEL
+/**
+ * 水平方向一行的AVX2实现
+ * 先把用到的源像素整段转为float（除以255，与查找表逐位一致），
+ * 再每次计算8个相邻输出：每个抽头按各输出的起点收集8个像素的同一通道，与转置存放的权重相乘累加
+ * row_f 末尾需有 taps*3 个0，供超出count的抽头读取
+ */
+__attribute__((target("avx2")))
+void horizontal_row_avx2(const unsigned char* line, const ResampleAxis& axis, int out_count, bool swap_rb,
+                         float* row_f, float* out) {
+    const int begin = axis.src_begin * 3;
+    const int length = (axis.src_end - axis.src_begin) * 3;
+    const unsigned char* p = line + begin;
+    const __m256 divisor = _mm256_set1_ps(255.0f);
+    int i = 0;
+    for (; i + 8 <= length; i += 8) {
+        __m256i bytes = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p + i)));
+        _mm256_storeu_ps(row_f + i, _mm256_div_ps(_mm256_cvtepi32_ps(bytes), divisor));
+    }
+    for (; i < length; ++i) {
+        row_f[i] = static_cast<float>(p[i]) / 255.0f;
+    }
+
+    const int c0 = swap_rb ? 2 : 0;
+    const int c2 = swap_rb ? 0 : 2;
+    const int groups = out_count / 8;
+    for (int g = 0; g < groups; ++g) {
+        __m256i base = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&axis.start[g * 8]));
+        base = _mm256_mullo_epi32(_mm256_sub_epi32(base, _mm256_set1_epi32(axis.src_begin)), _mm256_set1_epi32(3));
+        const float* w = &axis.lane_weights[static_cast<size_t>(g) * axis.taps * 8];
+        __m256 wj = _mm256_loadu_ps(w);
+        __m256 r = _mm256_mul_ps(_mm256_i32gather_ps(row_f + c0, base, 4), wj);
+        __m256 gr = _mm256_mul_ps(_mm256_i32gather_ps(row_f + 1, base, 4), wj);
+        __m256 b = _mm256_mul_ps(_mm256_i32gather_ps(row_f + c2, base, 4), wj);
+        for (int j = 1; j < axis.taps; ++j) {
+            base = _mm256_add_epi32(base, _mm256_set1_epi32(3));
+            wj = _mm256_loadu_ps(w + j * 8);
+            r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_i32gather_ps(row_f + c0, base, 4), wj));
+            gr = _mm256_add_ps(gr, _mm256_mul_ps(_mm256_i32gather_ps(row_f + 1, base, 4), wj));
+            b = _mm256_add_ps(b, _mm256_mul_ps(_mm256_i32gather_ps(row_f + c2, base, 4), wj));
+        }
+        // 8个输出的RGB交错写出
+        alignas(32) float lanes[3][8];
+        _mm256_store_ps(lanes[0], r);
+        _mm256_store_ps(lanes[1], gr);
+        _mm256_store_ps(lanes[2], b);
+        float* o = out + g * 24;
+        for (int k = 0; k < 8; ++k) {
+            o[k * 3 + 0] = lanes[0][k];
+            o[k * 3 + 1] = lanes[1][k];
+            o[k * 3 + 2] = lanes[2][k];
+        }
+    }
+
+    // 不足一组的输出
+    for (int x = groups * 8; x < out_count; ++x) {
+        const float* w = &axis.weights[static_cast<size_t>(x) * axis.taps];
+        const float* q = row_f + (axis.start[x] - axis.src_begin) * 3;
+        float r = q[c0] * w[0];
+        float gr = q[1] * w[0];
+        float b = q[c2] * w[0];
+        for (int j = 1; j < axis.count[x]; ++j) {
+            r += q[j * 3 + c0] * w[j];
+            gr += q[j * 3 + 1] * w[j];
+            b += q[j * 3 + c2] * w[j];
+        }
+        out[x * 3 + 0] = r;
+        out[x * 3 + 1] = gr;
+        out[x * 3 + 2] = b;
+    }
+}
+#endif
+
+// 垂直方向：输出行是若干水平结果行的加权和，沿行方向连续，由编译器向量化
+ML_TARGET_CLONES
+void vertical_pass(const float* rows, size_t row_len, int row_begin, const ResampleAxis& axis, int out_count, float* dst) {
+    for (int y = 0; y < out_count; ++y) {
+        const float* w = &axis.weights[static_cast<size_t>(y) * axis.taps];
+        const float* first = rows + static_cast<size_t>(axis.start[y] - row_begin) * row_len;
+        float* out = dst + static_cast<size_t>(y) * row_len;
+        for (size_t i = 0; i < row_len; ++i) {
+            out[i] = first[i] * w[0];
+        }
+        for (int j = 1; j < axis.count[y]; ++j) {
+            const float* line = first + static_cast<size_t>(j) * row_len;
+            const float wj = w[j];
+            for (size_t i = 0; i < row_len; ++i) {
+                out[i] += line[i] * wj;
+            }
+        }
+    }
+}
+
+// 标准化一行的标量实现，order为输出通道对应的源通道
+template <typename T>
+void normalize_row_scalar(const T* src, int begin, int w, const int order[3], const NormalizeParams& params,
+                          NormalizeLayout layout, size_t plane, float* dst) {
+    for (int x = begin; x < w; ++x) {
+        const T* p = src + static_cast<size_t>(x) * 3;
+        for (int c = 0; c < 3; ++c) {
+            float value = static_cast<float>(p[order[c]]) * params.scale[c] + params.bias[c];
+            if (layout == NORMALIZE_CHW) {
+                dst[c * plane + x] = value;
+            } else {
+                dst[x * 3 + c] = value;
+            }
+        }
+    }
+}
+
+#ifdef ML_AVX2_KERNEL
+// 8个交错像素读为3条向量：a=[r0 g0 b0 r1 g1 b1 r2 g2]，b=[b2 r3 ... r5]，c=[g5 b5 ... b7]
+__attribute__((target("avx2")))
+inline void load_pixels8(const float* p, __m256& a, __m256& b, __m256& c) {
+    a = _mm256_loadu_ps(p);
+    b = _mm256_loadu_ps(p + 8);
+    c = _mm256_loadu_ps(p + 16);
+}
+
+__attribute__((target("avx2")))
+inline void load_pixels8(const unsigned char* p, __m256& a, __m256& b, __m256& c) {
+    a = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p))));
+    b = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p + 8))));
+    c = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p + 16))));
+}
+
+/**
+ * 标准化一行的AVX2实现，每次处理8个像素
+ * 三条交错向量先按通道混合，再在向量内重排为8个像素的同一通道；HWC输出按相反的步骤交错回去
+ * 乘加分两步计算，与标量路径逐位一致
+ */
+template <typename T>
+__attribute__((target("avx2")))
+int normalize_row_avx2(const T* src, int w, bool swap_rb, const NormalizeParams& params,
+                       NormalizeLayout layout, size_t plane, float* dst) {
+    const __m256i order0 = _mm256_setr_epi32(0, 3, 6, 1, 4, 7, 2, 5);
+    const __m256i order1 = _mm256_setr_epi32(1, 4, 7, 2, 5, 0, 3, 6);
+    const __m256i order2 = _mm256_setr_epi32(2, 5, 0, 3, 6, 1, 4, 7);
+    const __m256i inverse1 = _mm256_setr_epi32(5, 0, 3, 6, 1, 4, 7, 2);
+    __m256 scale[3], bias[3];
+    for (int c = 0; c < 3; ++c) {
+        scale[c] = _mm256_set1_ps(params.scale[c]);
+        bias[c] = _mm256_set1_ps(params.bias[c]);
+    }
+
+    int x = 0;
+    for (; x + 8 <= w; x += 8) {
+        __m256 a, b, c;
+        load_pixels8(src + static_cast<size_t>(x) * 3, a, b, c);
+        // 源通道0在a的0,3,6、b的1,4,7、c的2,5位置，其余两个通道依次错开
+        __m256 ch[3];
+        ch[0] = _mm256_permutevar8x32_ps(_mm256_blend_ps(_mm256_blend_ps(a, b, 0x92), c, 0x24), order0);
+        ch[1] = _mm256_permutevar8x32_ps(_mm256_blend_ps(_mm256_blend_ps(a, b, 0x24), c, 0x49), order1);
+        ch[2] = _mm256_permutevar8x32_ps(_mm256_blend_ps(_mm256_blend_ps(a, b, 0x49), c, 0x92), order2);
+        if (swap_rb) {
+            std::swap(ch[0], ch[2]);
+        }
+        for (int k = 0; k < 3; ++k) {
+            ch[k] = _mm256_add_ps(_mm256_mul_ps(ch[k], scale[k]), bias[k]);
+        }
+
+        if (layout == NORMALIZE_CHW) {
+            _mm256_storeu_ps(dst + x, ch[0]);
+            _mm256_storeu_ps(dst + plane + x, ch[1]);
+            _mm256_storeu_ps(dst + 2 * plane + x, ch[2]);
+        } else {
+            // order0和order2是自身的逆排列
+            __m256 r = _mm256_permutevar8x32_ps(ch[0], order0);
+            __m256 g = _mm256_permutevar8x32_ps(ch[1], inverse1);
+            __m256 bl = _mm256_permutevar8x32_ps(ch[2], order2);
+            float* o = dst + static_cast<size_t>(x) * 3;
+            _mm256_storeu_ps(o, _mm256_blend_ps(_mm256_blend_ps(r, g, 0x92), bl, 0x24));
+            _mm256_storeu_ps(o + 8, _mm256_blend_ps(_mm256_blend_ps(r, g, 0x24), bl, 0x49));
+            _mm256_storeu_ps(o + 16, _mm256_blend_ps(_mm256_blend_ps(r, g, 0x49), bl, 0x92));
+        }
+    }
+    return x;
+}
+#endif
+
+// 逐行标准化，src_step为源图像一行的元素个数
+template <typename T>
+void normalize_rows(const T* src, int h, int w, size_t src_step, bool swap_rb, const NormalizeParams& params,
+                    NormalizeLayout layout, float* dst, bool allow_simd) {
+    const int order[3] = {swap_rb ? 2 : 0, 1, swap_rb ? 0 : 2};
+    const size_t plane = static_cast<size_t>(h) * w;
+#ifdef ML_AVX2_KERNEL
+    const bool use_avx2 = allow_simd && has_avx2();
+#else
+    (void)allow_simd;
+#endif
+    for (int y = 0; y < h; ++y) {
+        const T* line = src + static_cast<size_t>(y) * src_step;
+        float* out = dst + static_cast<size_t>(y) * w * (layout == NORMALIZE_CHW ? 1 : 3);
+        int done = 0;
+#ifdef ML_AVX2_KERNEL
+        if (use_avx2) {
+            done = normalize_row_avx2(line, w, swap_rb, params, layout, plane, out);
+        }
+#endif
+        normalize_row_scalar(line, done, w, order, params, layout, plane, out);
+    }
+}
+
+} // namespace
+
+void compute_resample_axis(int in_size, int out_size, int out_begin, int out_count, ResampleAxis& axis) {
+    // 以下表达式的类型与torch的_compute_indices_min_size_weights_aa保持一致
+    float scale = static_cast<float>(in_size) / out_size;
+    float support = scale >= 1.0f ? 1.0f * scale : 1.0f;
+    float invscale = scale >= 1.0f ? 1.0 / scale : 1.0;
+    axis.in_size = in_size;
+    axis.out_size = out_size;
+    axis.out_begin = out_begin;
+    axis.taps = static_cast<int>(std::ceil(support)) * 2 + 1;
+    axis.start.assign(out_count, 0);
+    axis.count.assign(out_count, 0);
+    axis.weights.assign(static_cast<size_t>(out_count) * axis.taps, 0.0f);
+    axis.src_begin = in_size;
+    axis.src_end = 0;
+
+    for (int k = 0; k < out_count; ++k) {
+        int64_t i = out_begin + k;
+        float center = scale * (i + 0.5);
+        int64_t xmin = std::max(static_cast<int64_t>(center - support + 0.5), static_cast<int64_t>(0));
+        int64_t xsize = std::min(static_cast<int64_t>(center + support + 0.5), static_cast<int64_t>(in_size)) - xmin;
+        xsize = std::min<int64_t>(xsize, axis.taps);
+
+        float* w = &axis.weights[static_cast<size_t>(k) * axis.taps];
+        float total_w = 0.0f;
+        for (int64_t j = 0; j < xsize; ++j) {
+            w[j] = triangle_filter((j + xmin - center + 0.5) * invscale);
+            total_w += w[j];
+        }
+        if (total_w != 0.0f) {
+            for (int64_t j = 0; j < xsize; ++j) {
+                w[j] /= total_w;
+            }
+        }
+        axis.start[k] = static_cast<int>(xmin);
+        axis.count[k] = static_cast<int>(xsize);
+        axis.src_begin = std::min(axis.src_begin, static_cast<int>(xmin));
+        axis.src_end = std::max(axis.src_end, static_cast<int>(xmin + xsize));
+    }
+
+    // SIMD布局
+    int groups = out_count / 8;
+    axis.lane_weights.assign(static_cast<size_t>(groups) * axis.taps * 8, 0.0f);
+    for (int k = 0; k < groups * 8; ++k) {
+        float* lane = &axis.lane_weights[static_cast<size_t>(k / 8) * axis.taps * 8 + k % 8];
+        for (int j = 0; j < axis.count[k]; ++j) {
+            lane[j * 8] = axis.weights[static_cast<size_t>(k) * axis.taps + j];
+        }
+    }
+}
+
+void resize_crop_u8(
+    const unsigned char* src, int src_h, int src_w, size_t src_step, bool swap_rb,
+    int resized_h, int resized_w,
+    int crop_top, int crop_left, int crop_h, int crop_w,
+    float* dst,
+    bool allow_simd
+) {
+    if (crop_top < 0 || crop_left < 0 || crop_top + crop_h > resized_h || crop_left + crop_w > resized_w) {
+        throw std::runtime_error("Crop region " + std::to_string(crop_h) + "x" + std::to_string(crop_w) +
+                                 " exceeds resized image " + std::to_string(resized_h) + "x" + std::to_string(resized_w));
+    }
+
+    // 系数与临时存储每个线程一份，尺寸不变时复用
+    thread_local ResampleAxis horizontal;
+    thread_local ResampleAxis vertical;
+    thread_local std::vector<float> rows;   // 水平缩放后的行 [vertical.src_end - vertical.src_begin, crop_w, 3]
+    thread_local std::vector<float> row_f;  // AVX2路径中转为float的一段源像素，末尾补0
+
+    if (!horizontal.matches(src_w, resized_w, crop_left, crop_w)) {
+        compute_resample_axis(src_w, resized_w, crop_left, crop_w, horizontal);
+    }
+    if (!vertical.matches(src_h, resized_h, crop_top, crop_h)) {
+        compute_resample_axis(src_h, resized_h, crop_top, crop_h, vertical);
+    }
+
+    const int row_begin = vertical.src_begin;
+    const int row_count = vertical.src_end - vertical.src_begin;
+    const size_t row_len = static_cast<size_t>(crop_w) * 3;
+    rows.resize(static_cast<size_t>(row_count) * row_len);
+
+    // 水平方向：只处理垂直方向用到的源行，只计算裁剪区域内的列
+#ifdef ML_AVX2_KERNEL
+    const bool use_avx2 = allow_simd && has_avx2();
+    if (use_avx2) {
+        row_f.assign(static_cast<size_t>(horizontal.src_end - horizontal.src_begin + horizontal.taps) * 3, 0.0f);
+    }
+#endif
+    for (int r = 0; r < row_count; ++r) {
+        const unsigned char* line = src + static_cast<size_t>(row_begin + r) * src_step;
+        float* out = &rows[static_cast<size_t>(r) * row_len];
+#ifdef ML_AVX2_KERNEL
+        if (use_avx2) {
+            horizontal_row_avx2(line, horizontal, crop_w, swap_rb, row_f.data(), out);
+            continue;
+        }
+#endif
+        horizontal_row_scalar(line, horizontal, crop_w, swap_rb, out);
+    }
+
+    vertical_pass(rows.data(), row_len, row_begin, vertical, crop_h, dst);
+}
+
+NormalizeParams make_normalize_params(const float mean[3], const float std_dev[3], float input_max) {
+    NormalizeParams params;
+    for (int c = 0; c < 3; ++c) {
+        if (std_dev[c] == 0.0f || input_max == 0.0f) {
+            throw std::runtime_error("Normalization std and input range must be non-zero");
+        }
+        params.scale[c] = static_cast<float>(1.0 / (static_cast<double>(input_max) * std_dev[c]));
+        params.bias[c] = static_cast<float>(-static_cast<double>(mean[c]) / std_dev[c]);
+    }
+    return params;
+}
+
+void normalize_hwc_f32(
+    const float* src, int h, int w,
+    const NormalizeParams& params, NormalizeLayout layout,
+    float* dst,
+    bool allow_simd
+) {
+    normalize_rows(src, h, w, static_cast<size_t>(w) * 3, false, params, layout, dst, allow_simd);
+}
+
+void normalize_hwc_u8(
+    const unsigned char* src, int h, int w, size_t src_step, bool swap_rb,
+    const NormalizeParams& params, NormalizeLayout layout,
+    float* dst,
+    bool allow_simd
+) {
+    normalize_rows(src, h, w, src_step, swap_rb, params, layout, dst, allow_simd);
+}
+
+const char* image_kernel_simd_path() {
+    return has_avx2() ? "avx2" : "scalar";
+}
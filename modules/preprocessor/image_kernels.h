@@ -0,0 +1,111 @@
+#ifndef IMAGE_KERNELS_H
+#define IMAGE_KERNELS_H
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * 一维抗锯齿双线性重采样的系数，与torch interpolate(bilinear, antialias=True, align_corners=False)一致
+ * 只覆盖输出下标 [out_begin, out_begin + 输出个数) 的一段，用于缩放后立即裁剪的场合
+ * 系数只与尺寸有关，尺寸不变时重复使用，不必每帧重算
+ */
+struct ResampleAxis {
+    int in_size = 0;                // 系数对应的尺寸，用于判断能否复用
+    int out_size = 0;
+    int out_begin = 0;
+
+    int taps = 0;                   // 每个输出的最大抽头数，weights的行长度
+    std::vector<int> start;         // 每个输出的第一个输入下标
+    std::vector<int> count;         // 每个输出的抽头数
+    std::vector<float> weights;     // [输出个数, taps]，每行和为1，不足taps的部分为0
+    int src_begin = 0;              // 用到的输入下标范围 [src_begin, src_end)
+    int src_end = 0;
+
+    /**
+     * SIMD布局：每8个相邻输出为一组，权重按 [组, taps, 8] 转置存放，组内超出count的抽头权重为0
+     * 一组输出的同一抽头在一条向量中计算，求和顺序与标量路径相同
+     */
+    std::vector<float> lane_weights;
+
+    bool matches(int in_size, int out_size, int out_begin, int out_count) const {
+        return this->in_size == in_size && this->out_size == out_size &&
+               this->out_begin == out_begin && static_cast<int>(start.size()) == out_count;
+    }
+};
+
+/**
+ * 计算输入长度in_size缩放到out_size时，输出 [out_begin, out_begin + out_count) 的系数
+ * 缩小时三角滤波器的支撑按比例放大（抗锯齿），放大时退化为普通双线性
+ */
+void compute_resample_axis(int in_size, int out_size, int out_begin, int out_count, ResampleAxis& axis);
+
+/**
+ * 对交错存放的3通道uint8图像做抗锯齿双线性缩放并裁剪，只计算裁剪区域内的输出
+ * 等价于先除以255转为float，缩放到 resized_h x resized_w，再取从(crop_top, crop_left)开始的 crop_h x crop_w
+ * 先水平后垂直两遍，与torch的计算顺序一致；中间结果保持float，不做8位量化
+ * 系数按尺寸缓存在调用线程中；CPU支持AVX2时水平方向每次计算8个输出，结果与标量路径逐位一致
+ * @param src 源图像首行，每行src_step字节，每个像素3个字节
+ * @param swap_rb 源图像为BGR顺序时为true，输出总是RGB
+ * @param dst 输出 [crop_h, crop_w, 3]，RGB，取值[0, 1]
+ * @param allow_simd 为false时强制使用标量路径
+ * @throws std::runtime_error 如果裁剪区域超出缩放后的图像
+ */
+void resize_crop_u8(
+    const unsigned char* src, int src_h, int src_w, size_t src_step, bool swap_rb,
+    int resized_h, int resized_w,
+    int crop_top, int crop_left, int crop_h, int crop_w,
+    float* dst,
+    bool allow_simd = true
+);
+
+/**
+ * 逐通道标准化 y = x * scale + bias，由 (x / input_max - mean) / std 展开得到
+ * 除以input_max、减均值、除标准差合并为一次乘加
+ */
+struct NormalizeParams {
+    float scale[3] = {1.0f, 1.0f, 1.0f};
+    float bias[3] = {0.0f, 0.0f, 0.0f};
+};
+
+/**
+ * @param input_max 输入取值上限，float图像为1，8位图像为255
+ */
+NormalizeParams make_normalize_params(const float mean[3], const float std_dev[3], float input_max);
+
+// 标准化输出的内存布局
+enum NormalizeLayout
+{
+    NORMALIZE_CHW = 0,  // [3, h, w]，模型输入的布局
+    NORMALIZE_HWC = 1   // [h, w, 3]
+};
+
+/**
+ * 读取交错存放的RGB float图像，一次完成标准化和布局转换，写入调用方提供的缓冲区
+ * dst可以是批量张量中的一个样本，不另外分配
+ * @param src [h, w, 3]，连续存放
+ * @param dst 输出 h * w * 3 个float，布局由layout决定
+ * @param allow_simd 为false时强制使用标量路径
+ */
+void normalize_hwc_f32(
+    const float* src, int h, int w,
+    const NormalizeParams& params, NormalizeLayout layout,
+    float* dst,
+    bool allow_simd = true
+);
+
+/**
+ * 与normalize_hwc_f32相同，直接读取3通道uint8图像（例如解码后图像的裁剪区域）
+ * @param src 首行，每行src_step字节
+ * @param swap_rb 源图像为BGR顺序时为true，params和输出总是RGB顺序
+ */
+void normalize_hwc_u8(
+    const unsigned char* src, int h, int w, size_t src_step, bool swap_rb,
+    const NormalizeParams& params, NormalizeLayout layout,
+    float* dst,
+    bool allow_simd = true
+);
+
+// 当前CPU上resize_crop_u8和normalize_hwc_*使用的指令集："avx2" 或 "scalar"
+const char* image_kernel_simd_path();
+
+#endif
@@ -0,0 +1,51 @@
+#include "feature_store_pool.h"
+#include <new>
+#include <stdexcept>
+#include <string>
+
+FeatureStorePool::FeatureStorePool(
+    double deltaT,
+    int based_window,
+    int cache_length,
+    int max_sequence_length,
+    int smooth_window,
+    bool lazy_sequence
+) : deltaT(deltaT),
+    based_window(based_window),
+    cache_length(cache_length),
+    max_sequence_length(max_sequence_length),
+    smooth_window(smooth_window),
+    lazy_sequence(lazy_sequence)
+{
+}
+
+FeatureStorePool::~FeatureStorePool() {
+    for (int slot = 0; slot < constructed_count; ++slot) {
+        address(slot)->~Feature_Store();
+    }
+}
+
+Feature_Store* FeatureStorePool::obtain(int slot) {
+    if (slot < constructed_count) {
+        Feature_Store* feature_store = address(slot);
+        feature_store->reset();
+        return feature_store;
+    }
+    if (slot != constructed_count) {
+        throw std::runtime_error("Feature store pool slot out of order: " + std::to_string(slot));
+    }
+
+    if ((slot >> CHUNK_SHIFT) >= static_cast<int>(chunks.size())) {
+        chunks.push_back(std::make_unique<Chunk>());
+    }
+    Feature_Store* feature_store = new (address(slot)) Feature_Store(
+        deltaT,
+        based_window,
+        cache_length,
+        max_sequence_length,
+        smooth_window,
+        lazy_sequence
+    );
+    ++constructed_count;
+    return feature_store;
+}
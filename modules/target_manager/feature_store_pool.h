@@ -0,0 +1,66 @@
+#ifndef FEATURE_STORE_POOL_H
+#define FEATURE_STORE_POOL_H
+
+#include <memory>
+#include <vector>
+#include "../feature_store/feature_store.h"
+
+/**
+ * Feature_Store对象池
+ * 对象按块存放，每块 CHUNK_SIZE 个对象连续排列，对象地址在对象池生命周期内不变
+ * 槽位第一次使用时构造对象；释放后再次使用同一槽位时调用reset()，
+ * 复用原对象及其内部缓存，热身之后目标的创建与移除不再分配内存
+ * 槽位按0,1,2...的顺序首次使用，与TargetManager的槽位一一对应
+ */
+class FeatureStorePool {
+public:
+    static constexpr int CHUNK_SHIFT = 6;
+    static constexpr int CHUNK_SIZE = 1 << CHUNK_SHIFT;
+
+private:
+    struct Chunk {
+        alignas(Feature_Store) unsigned char storage[CHUNK_SIZE * sizeof(Feature_Store)];
+    };
+
+    std::vector<std::unique_ptr<Chunk>> chunks;
+    int constructed_count = 0;
+
+    double deltaT;
+    int based_window;
+    int cache_length;
+    int max_sequence_length;
+    int smooth_window;
+    bool lazy_sequence;
+
+    Feature_Store* address(int slot) const {
+        return reinterpret_cast<Feature_Store*>(chunks[slot >> CHUNK_SHIFT]->storage) + (slot & (CHUNK_SIZE - 1));
+    }
+
+public:
+    FeatureStorePool(
+        double deltaT,
+        int based_window,
+        int cache_length,
+        int max_sequence_length,
+        int smooth_window,
+        bool lazy_sequence
+    );
+    ~FeatureStorePool();
+    FeatureStorePool(const FeatureStorePool&) = delete;
+    FeatureStorePool& operator=(const FeatureStorePool&) = delete;
+
+    /**
+     * 取得槽位上的对象，首次使用时构造，否则重置为初始状态
+     * @param slot 已构造的槽位，或下一个未构造的槽位 constructed()
+     * @throws std::runtime_error 如果槽位跳过了未构造的槽位
+     */
+    Feature_Store* obtain(int slot);
+
+    // 已构造槽位上的对象，不检查范围
+    Feature_Store* at(int slot) const { return address(slot); }
+
+    // 已构造的对象个数，槽位 [0, constructed()) 上均有对象
+    int constructed() const { return constructed_count; }
+};
+
+#endif
@@ -0,0 +1,165 @@
+#include "ingest_queue.h"
+#include <chrono>
+#include <stdexcept>
+#include <utility>
+
+IngestQueue::IngestQueue(
+    TargetManager& manager,
+    int capacity_per_shard,
+    int drain_batch,
+    int idle_wait_us
+) : manager(manager),
+    drain_batch(drain_batch),
+    idle_wait_us(idle_wait_us),
+    drained(0),
+    failed(0),
+    latency_total_ns(0),
+    latency_max_ns(0),
+    running(false)
+{
+    if (drain_batch < 1) {
+        throw std::runtime_error("Invalid drain batch: " + std::to_string(drain_batch));
+    }
+    for (int shard = 0; shard < manager.shard_count(); ++shard) {
+        rings.push_back(std::make_unique<MpscRing<IngestMessage>>(capacity_per_shard));
+    }
+    frame.reserve(drain_batch);
+    batch_enqueue_ns.reserve(drain_batch);
+}
+
+IngestQueue::~IngestQueue() {
+    stop();
+}
+
+std::int64_t IngestQueue::now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()
+    ).count();
+}
+
+bool IngestQueue::push_trace(const TraceMeasurement& measurement) {
+    IngestMessage entry;
+    entry.trace = measurement;
+    entry.enqueue_ns = now_ns();
+    return rings[manager.target_shard(measurement.target_id)]->try_push(std::move(entry));
+}
+
+bool IngestQueue::push_image(int target_id, std::vector<unsigned char> image_data) {
+    return push_image(target_id, std::make_shared<const std::vector<unsigned char>>(std::move(image_data)));
+}
+
+bool IngestQueue::push_image(int target_id, ImageBuffer image_data) {
+    if (!image_data) {
+        throw std::runtime_error("Empty image buffer");
+    }
+    IngestMessage entry;
+    entry.trace.target_id = target_id;
+    entry.image = std::move(image_data);
+    entry.has_image = true;
+    entry.enqueue_ns = now_ns();
+    return rings[manager.target_shard(target_id)]->try_push(std::move(entry));
+}
+
+int IngestQueue::drain() {
+    int total = 0;
+    for (auto& ring : rings) {
+        frame.clear();
+        batch_enqueue_ns.clear();
+        while (static_cast<int>(batch_enqueue_ns.size()) < drain_batch && ring->try_pop(message)) {
+            batch_enqueue_ns.push_back(message.enqueue_ns);
+            if (message.has_image) {
+                // 航迹与图像写入目标的不同部分，互不影响先后
+                // 其他线程在两步之间移除了目标时句柄失效，与写入失败一样计数
+                try {
+                    if (!manager.update_target_image(manager.add_target(message.trace.target_id), std::move(message.image))) {
+                        failed.fetch_add(1, std::memory_order_relaxed);
+                    }
+                } catch (...) {
+                    failed.fetch_add(1, std::memory_order_relaxed);
+                }
+                message.image.reset();
+            } else {
+                frame.push_back(message.trace);
+            }
+        }
+        if (batch_enqueue_ns.empty()) {
+            continue;
+        }
+        if (!frame.empty()) {
+            // 写入失败时整批航迹量测计为失败，消费者继续运行，已取出的量测照常计入drained
+            try {
+                manager.update_targets_trace(frame, true);
+            } catch (...) {
+                failed.fetch_add(frame.size(), std::memory_order_relaxed);
+            }
+        }
+
+        // 延迟统计只由消费者写入
+        std::int64_t now = now_ns();
+        std::uint64_t batch_total = 0;
+        std::uint64_t batch_max = latency_max_ns.load(std::memory_order_relaxed);
+        for (std::int64_t enqueue_ns : batch_enqueue_ns) {
+            std::uint64_t latency = static_cast<std::uint64_t>(now - enqueue_ns);
+            batch_total += latency;
+            batch_max = latency > batch_max ? latency : batch_max;
+        }
+        latency_total_ns.fetch_add(batch_total, std::memory_order_relaxed);
+        latency_max_ns.store(batch_max, std::memory_order_relaxed);
+        drained.fetch_add(batch_enqueue_ns.size(), std::memory_order_release);
+        total += static_cast<int>(batch_enqueue_ns.size());
+    }
+    return total;
+}
+
+void IngestQueue::flush() {
+    std::uint64_t target = 0;
+    for (const auto& ring : rings) {
+        target += ring->pushed();
+    }
+    while (drained.load(std::memory_order_acquire) < target) {
+        if (running.load()) {
+            std::this_thread::sleep_for(std::chrono::microseconds(idle_wait_us));
+        } else if (drain() == 0) {
+            // 生产者已占位但尚未写完
+            std::this_thread::yield();
+        }
+    }
+}
+
+void IngestQueue::start() {
+    if (running.exchange(true)) {
+        return;
+    }
+    worker = std::thread([this]() {
+        while (running.load()) {
+            if (drain() == 0) {
+                std::this_thread::sleep_for(std::chrono::microseconds(idle_wait_us));
+            }
+        }
+    });
+}
+
+void IngestQueue::stop() {
+    if (!running.exchange(false)) {
+        return;
+    }
+    worker.join();
+    while (drain() > 0) {
+    }
+}
+
+IngestStats IngestQueue::stats() const {
+    IngestStats result;
+    for (const auto& ring : rings) {
+        result.depth += ring->size();
+        result.enqueued += ring->pushed();
+        result.dropped += ring->dropped();
+    }
+    result.drained = drained.load(std::memory_order_acquire);
+    result.failed = failed.load(std::memory_order_relaxed);
+    if (result.drained > 0) {
+        result.mean_latency_us = latency_total_ns.load(std::memory_order_relaxed) / 1000.0 / result.drained;
+    }
+    result.max_latency_us = latency_max_ns.load(std::memory_order_relaxed) / 1000.0;
+    return result;
+}
@@ -0,0 +1,116 @@
+#ifndef INGEST_QUEUE_H
+#define INGEST_QUEUE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "target_manager.h"
+#include "mpsc_ring.h"
+
+/**
+ * 队列的运行统计
+ */
+struct IngestStats {
+    std::size_t depth = 0;              // 当前排队的量测个数
+    std::uint64_t enqueued = 0;         // 累计入队
+    std::uint64_t dropped = 0;          // 累计因队列满被丢弃
+    std::uint64_t drained = 0;          // 累计已取出处理，包含写入失败的量测
+    std::uint64_t failed = 0;           // 累计写入目标时出错的量测，同一批的航迹量测一起计入
+    double mean_latency_us = 0.0;       // 入队到写入目标的平均延迟
+    double max_latency_us = 0.0;        // 入队到写入目标的最大延迟
+};
+
+/**
+ * 目标量测的异步写入队列
+ * TargetManager的每个分片对应一个无锁MPSC队列，传感器线程入队即返回，从不等待特征计算
+ * 唯一的消费者（后台线程或调用drain的线程）按分片成批取出量测，
+ * 航迹量测以一帧的形式交给update_targets_trace做向量化计算，不存在的目标自动添加
+ * 同一目标的量测需由同一线程按时间顺序入队，写入顺序与入队顺序一致
+ */
+class IngestQueue {
+private:
+    // 一条排队的量测，has_image为true时为图像，否则为航迹
+    struct IngestMessage {
+        TraceMeasurement trace;
+        ImageBuffer image;
+        bool has_image = false;
+        std::int64_t enqueue_ns = 0;
+    };
+
+    TargetManager& manager;
+    std::vector<std::unique_ptr<MpscRing<IngestMessage>>> rings;
+    int drain_batch;
+    int idle_wait_us;
+
+    // 消费者使用的临时存储
+    IngestMessage message;
+    std::vector<TraceMeasurement> frame;
+    std::vector<std::int64_t> batch_enqueue_ns;
+
+    std::atomic<std::uint64_t> drained;
+    std::atomic<std::uint64_t> failed;
+    std::atomic<std::uint64_t> latency_total_ns;
+    std::atomic<std::uint64_t> latency_max_ns;
+
+    std::atomic<bool> running;
+    std::thread worker;
+
+    static std::int64_t now_ns();
+
+public:
+    /**
+     * @param manager 写入的目标管理器，生命周期需长于队列
+     * @param capacity_per_shard 每个分片队列的容量，向上取整为2的幂
+     * @param drain_batch 每个分片每轮最多取出的量测个数
+     * @param idle_wait_us 后台线程在队列全空时的等待时间（微秒）
+     */
+    IngestQueue(
+        TargetManager& manager,
+        int capacity_per_shard = 4096,
+        int drain_batch = 256,
+        int idle_wait_us = 100
+    );
+    ~IngestQueue();
+    IngestQueue(const IngestQueue&) = delete;
+    IngestQueue& operator=(const IngestQueue&) = delete;
+
+    /**
+     * 航迹量测入队，可被多个线程同时调用
+     * @return 所在分片的队列已满时返回false，量测被丢弃
+     */
+    bool push_trace(const TraceMeasurement& measurement);
+
+    /**
+     * 图像入队，可被多个线程同时调用
+     * @return 所在分片的队列已满时返回false，图像被丢弃
+     */
+    bool push_image(int target_id, std::vector<unsigned char> image_data);
+
+    // 共享图像入队，队列与目标持有同一份数据
+    bool push_image(int target_id, ImageBuffer image_data);
+
+    /**
+     * 取出全部分片中已排队的量测并写入目标，每个分片最多drain_batch个
+     * 写入出错的量测计入stats().failed，不会抛出异常
+     * 只能由唯一的消费者调用，后台线程运行时不要调用
+     * @return 本轮写入的量测个数
+     */
+    int drain();
+
+    /**
+     * 等待调用前已入队的量测全部写入目标
+     * 后台线程未运行时在当前线程中处理
+     */
+    void flush();
+
+    // 启动/停止后台消费线程，停止时处理完剩余量测
+    void start();
+    void stop();
+    bool is_running() const { return running.load(); }
+
+    IngestStats stats() const;
+};
+
+#endif
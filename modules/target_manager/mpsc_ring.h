@@ -0,0 +1,113 @@
+#ifndef MPSC_RING_H
+#define MPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+
+/**
+ * 有界无锁多生产者单消费者环形队列
+ * 每个单元带一个序号，生产者以CAS抢占写入位置，写完后发布序号；
+ * 消费者按序号判断单元是否已写好，不需要CAS
+ * 队列满时try_push立即返回false，生产者从不阻塞
+ */
+template <typename T>
+class MpscRing {
+private:
+    struct Cell {
+        std::atomic<std::size_t> sequence;
+        T data;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    std::size_t mask;
+    alignas(64) std::atomic<std::size_t> enqueue_pos;
+    alignas(64) std::atomic<std::size_t> dequeue_pos;
+    alignas(64) std::atomic<std::uint64_t> rejected;
+
+public:
+    // capacity 向上取整为2的幂
+    explicit MpscRing(std::size_t capacity)
+        : enqueue_pos(0), dequeue_pos(0), rejected(0)
+    {
+        if (capacity < 2) {
+            throw std::runtime_error("MpscRing capacity must be at least 2");
+        }
+        std::size_t size = 2;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        cells.reset(new Cell[size]);
+        for (std::size_t i = 0; i < size; ++i) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        mask = size - 1;
+    }
+
+    MpscRing(const MpscRing&) = delete;
+    MpscRing& operator=(const MpscRing&) = delete;
+
+    /**
+     * 写入一个元素，可被多个线程同时调用
+     * @return 队列已满时返回false，元素被丢弃
+     */
+    template <typename U>
+    bool try_push(U&& value) {
+        std::size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells[pos & mask];
+            std::size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            std::intptr_t diff = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                rejected.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            } else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = std::forward<U>(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * 取出一个元素，只能由唯一的消费者线程调用
+     * @return 队列为空（或队首元素尚未写完）时返回false
+     */
+    bool try_pop(T& value) {
+        std::size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        Cell* cell = &cells[pos & mask];
+        std::size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        if (static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(pos + 1) < 0) {
+            return false;
+        }
+        value = std::move(cell->data);
+        cell->sequence.store(pos + mask + 1, std::memory_order_release);
+        dequeue_pos.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    std::size_t capacity() const { return mask + 1; }
+
+    // 当前排队的元素个数，并发写入时为近似值
+    std::size_t size() const {
+        std::size_t tail = dequeue_pos.load(std::memory_order_acquire);
+        std::size_t head = enqueue_pos.load(std::memory_order_acquire);
+        return head > tail ? head - tail : 0;
+    }
+
+    // 累计写入成功的元素个数
+    std::uint64_t pushed() const { return enqueue_pos.load(std::memory_order_acquire); }
+
+    // 累计因队列满被丢弃的元素个数
+    std::uint64_t dropped() const { return rejected.load(std::memory_order_relaxed); }
+};
+
+#endif
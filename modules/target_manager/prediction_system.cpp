@@ -12,13 +12,22 @@ PredictionSystem::PredictionSystem(
     double target_delta_t,
     int target_based_window,
     int target_cache_length,
-    DeviceType device_type
-) : target_manager(target_delta_t, target_based_window, target_cache_length),
+    DeviceType device_type,
+    int sequence_length,
+    int sequence_stride,
+    bool allow_incomplete,
+    bool lazy_sequence,
+    int target_shards,
+    PreprocessMode preprocess_mode
+) : target_manager(target_delta_t, target_based_window, target_cache_length, sequence_length, trace_smooth_window, lazy_sequence, target_shards),
     target_recognition_model_figure(ModelType::CLASSIFICATION, device_type),
     target_recognition_model_trace(ModelType::CLASSIFICATION, device_type),
-    image_preprocessor(256, 224),
+    image_preprocessor(256, 224, preprocess_mode),
     trace_preprocessor(),
-    trace_smooth_window(trace_smooth_window)
+    trace_smooth_window(trace_smooth_window),
+    sequence_length(sequence_length),
+    sequence_stride(sequence_stride),
+    allow_incomplete_sequence(allow_incomplete)
 {
     if(!target_recognition_model_figure.load_model(target_recognition_model_figure_path)) {
         throw std::runtime_error("Failed to load target_recognition_model_figure from: " + 
@@ -34,6 +43,12 @@ PredictionSystem::PredictionSystem(
         throw std::runtime_error("Failed to load trace preprocessor parameters from: " + 
                                trace_mean_file + " and " + trace_scale_file);
     }
+
+    // 特征在入序列时即按相同参数标准化，识别时无需逐帧变换
+    target_manager.set_feature_normalization(
+        std::vector<double>(trace_preprocessor.mean().begin(), trace_preprocessor.mean().end()),
+        std::vector<double>(trace_preprocessor.scale().begin(), trace_preprocessor.scale().end())
+    );
 }
 
 bool PredictionSystem::update_info_for_target_trace(
@@ -52,14 +67,22 @@ bool PredictionSystem::update_info_for_target_trace(
     double filter_a_z
 ) 
 {
-    //check if has target
-    if(!target_manager.has_target(target_id)) {
-        //try to add target
-        target_manager.add_target(target_id);
+    if (ingest_queue) {
+        // 异步模式只入队，队列满时丢弃并返回false
+        TraceMeasurement measurement = {
+            target_id,
+            {obs_x, obs_y, obs_z},
+            {filter_p_x, filter_p_y, filter_p_z},
+            {filter_v_x, filter_v_y, filter_v_z},
+            {filter_a_x, filter_a_y, filter_a_z}
+        };
+        return ingest_queue->push_trace(measurement);
     }
+    //add target if missing, one lookup
+    TargetHandle handle = target_manager.add_target(target_id);
     //update target
     target_manager.update_target_trace(
-        target_id, 
+        handle, 
         obs_x, 
         obs_y, 
         obs_z, 
@@ -76,59 +99,199 @@ bool PredictionSystem::update_info_for_target_trace(
     return true;
 }
 
+bool PredictionSystem::update_info_for_targets_trace(
+    const std::vector<TraceMeasurement>& frame
+)
+{
+    if (ingest_queue) {
+        bool accepted = true;
+        for (const TraceMeasurement& measurement : frame) {
+            accepted &= ingest_queue->push_trace(measurement);
+        }
+        return accepted;
+    }
+    target_manager.update_targets_trace(frame, true);
+    return true;
+}
+
+bool PredictionSystem::update_info_for_target_trace_bulk(
+    int target_id,
+    const std::vector<TraceMeasurement>& measurements
+)
+{
+    if (ingest_queue) {
+        ingest_queue->flush();  // 先写入已排队的量测，保持时间顺序
+    }
+    //add target if missing, one lookup
+    TargetHandle handle = target_manager.add_target(target_id);
+    target_manager.update_target_trace_bulk(
+        handle,
+        measurements.data(),
+        static_cast<int>(measurements.size())
+    );
+    return true;
+}
+
 bool PredictionSystem::update_info_for_target_figure(
     int target_id, 
     const std::vector<unsigned char >& image_data
 ) 
 {
-    //check if has target
-    if(!target_manager.has_target(target_id)) {
-        //try to add target
-        target_manager.add_target(target_id);
+    // 复制一次，之后在队列与目标之间共享
+    return update_info_for_target_figure(target_id, std::make_shared<const std::vector<unsigned char>>(image_data));
+}
+
+bool PredictionSystem::update_info_for_target_figure(
+    int target_id,
+    std::vector<unsigned char >&& image_data
+)
+{
+    return update_info_for_target_figure(target_id, std::make_shared<const std::vector<unsigned char>>(std::move(image_data)));
+}
+
+bool PredictionSystem::update_info_for_target_figure(
+    int target_id,
+    ImageBuffer image_data
+)
+{
+    if (!image_data) {
+        throw std::runtime_error("Empty image buffer");
     }
+    if (ingest_queue) {
+        return ingest_queue->push_image(target_id, std::move(image_data));
+    }
+    //add target if missing, one lookup
+    TargetHandle handle = target_manager.add_target(target_id);
     //update target
-    target_manager.update_target_image(target_id, image_data);
+    target_manager.update_target_image(handle, std::move(image_data));
     return true;
 }
 
+bool PredictionSystem::update_info_for_target_trace(
+    TargetHandle handle,
+    double obs_x, double obs_y, double obs_z,
+    double filter_p_x, double filter_p_y, double filter_p_z,
+    double filter_v_x, double filter_v_y, double filter_v_z,
+    double filter_a_x, double filter_a_y, double filter_a_z
+)
+{
+    // 句柄已失效时返回false
+    return target_manager.update_target(handle, [&](Feature_Store& feature_store) {
+        feature_store.update(
+            obs_x, obs_y, obs_z,
+            filter_p_x, filter_p_y, filter_p_z,
+            filter_v_x, filter_v_y, filter_v_z,
+            filter_a_x, filter_a_y, filter_a_z
+        );
+    });
+}
+
+bool PredictionSystem::update_info_for_target_figure(
+    TargetHandle handle,
+    const std::vector<unsigned char >& image_data
+)
+{
+    return update_info_for_target_figure(handle, std::make_shared<const std::vector<unsigned char>>(image_data));
+}
+
+bool PredictionSystem::update_info_for_target_figure(
+    TargetHandle handle,
+    std::vector<unsigned char >&& image_data
+)
+{
+    return update_info_for_target_figure(handle, std::make_shared<const std::vector<unsigned char>>(std::move(image_data)));
+}
+
+bool PredictionSystem::update_info_for_target_figure(
+    TargetHandle handle,
+    ImageBuffer image_data
+)
+{
+    if (!image_data) {
+        throw std::runtime_error("Empty image buffer");
+    }
+    // 经由TargetManager写入以计入图像内存；句柄已失效时返回false
+    return target_manager.update_target_image(handle, std::move(image_data));
+}
+
+
+bool PredictionSystem::capture_recognition_input(
+    TargetHandle handle,
+    bool with_image,
+    bool with_trace,
+    RecognitionInput& input
+) {
+    input = RecognitionInput();
+    input.handle = handle;
+    auto capture = [&](const Feature_Store& feature_store) {
+        if (with_image && feature_store.is_image_initialized()) {
+            // 同一图像只识别一次；图像因内存上限被释放后由缓存代替
+            if (feature_store.has_figure_probs()) {
+                input.figure_probs = feature_store.get_figure_probs();
+                input.image_ready = true;
+            } else if (feature_store.has_image_data()) {
+                input.image = feature_store.get_image_buffer();
+                input.image_ready = true;
+            }
+        }
+        input.trace_ready = with_trace && feature_store.is_track_initialized() && feature_store.is_sequence_ready();
+        input.sequence_length = feature_store.get_max_sequence_length();
+    };
+    auto copy_sequence = [&](const float* sequence) {
+        input.sequence.assign(sequence, sequence + static_cast<size_t>(input.sequence_length) * TRACE_FEATURE_DIM);
+    };
+
+    // 惰性模式下序列特征在读取时才计算，需要写锁；否则多个识别可以共享读锁
+    if (with_trace && target_manager.is_lazy_sequence()) {
+        return target_manager.modify_target(handle, [&](Feature_Store& feature_store) {
+            capture(feature_store);
+            if (input.trace_ready) {
+                copy_sequence(feature_store.get_normalized_sequence());
+            }
+        });
+    }
+    return target_manager.visit_target(handle, [&](const Feature_Store& feature_store) {
+        capture(feature_store);
+        if (input.trace_ready) {
+            copy_sequence(feature_store.get_normalized_sequence());
+        }
+    });
+}
 
 void PredictionSystem::trace_model_sequence_recognition(
     int target_id,
     std::vector<float>& trace_probs
 ) {
-    auto feature_store = target_manager.get_feature_store(target_id);
-    if (!feature_store) {
+    trace_model_sequence_recognition(target_manager.find_target(target_id), trace_probs);
+}
+
+void PredictionSystem::trace_model_sequence_recognition(
+    TargetHandle handle,
+    std::vector<float>& trace_probs
+) {
+    RecognitionInput input;
+    if (!capture_recognition_input(handle, false, true, input)) {
         throw std::runtime_error("Target not found");
     }
+    trace_model_sequence_recognition(input, trace_probs);
+}
 
+void PredictionSystem::trace_model_sequence_recognition(
+    const RecognitionInput& input,
+    std::vector<float>& trace_probs
+) {
     // 检查轨迹特征和序列是否都准备好
-    if (!feature_store->is_track_initialized() || !feature_store->is_sequence_ready()) {
+    if (!input.trace_ready) {
         trace_probs.clear();  // 清空结果表示未准备好
         return;
     }
 
-    // 获取特征序列
-    const auto& sequence_features = feature_store->get_trace_features_sequence();
-
-    // 可选：返回特征序列用于调试
-    if (features_sequence) {
-        *features_sequence = std::vector<std::vector<double>>(
-            sequence_features.begin(), 
-            sequence_features.end()
-        );
-    }
-
-    // 预处理特征序列
-    std::vector<torch::Tensor> normalized_features;
-    normalized_features.reserve(sequence_features.size());
-    
-    for (const auto& features : sequence_features) {
-        normalized_features.push_back(trace_preprocessor.transform(features));
-    }
-
-    // 构建序列张量 [1, seq_length, feature_dim]
-    torch::Tensor sequence_tensor = torch::stack(normalized_features)
-        .unsqueeze(0);  // 添加批次维度
+    // 包装复制出的序列为张量 [1, seq_length, feature_dim]
+    torch::Tensor sequence_tensor = torch::from_blob(
+        const_cast<float*>(input.sequence.data()),
+        {1, static_cast<long>(input.sequence_length), TRACE_FEATURE_DIM},
+        torch::kFloat
+    );
 
     // 获取预测结果
     torch::Tensor probs = target_recognition_model_trace.predict_proba(sequence_tensor);
@@ -146,19 +309,37 @@ void PredictionSystem::figure_model_recognition(
     int target_id,
     std::vector<float>& figure_probs
 ) {
-    auto feature_store = target_manager.get_feature_store(target_id);
-    if (!feature_store) {
+    figure_model_recognition(target_manager.find_target(target_id), figure_probs);
+}
+
+void PredictionSystem::figure_model_recognition(
+    TargetHandle handle,
+    std::vector<float>& figure_probs
+) {
+    RecognitionInput input;
+    if (!capture_recognition_input(handle, true, false, input)) {
         throw std::runtime_error("Target not found");
     }
-    
-    if (!feature_store->is_image_initialized()) {
+    figure_model_recognition(input, figure_probs);
+}
+
+void PredictionSystem::figure_model_recognition(
+    RecognitionInput& input,
+    std::vector<float>& figure_probs
+) {
+    if (!input.image_ready) {
         figure_probs.clear();  // 清空结果表示未准备好
         return;
     }
+    if (!input.figure_probs.empty()) {
+        figure_probs = input.figure_probs;
+        return;
+    }
 
     // Get and preprocess image
-    const std::vector<unsigned char>& image_data = feature_store->get_image_data();
-    torch::Tensor normalized_image = image_preprocessor.preprocess(image_data);
+    // 直接在共享的图像缓冲区上解码，不复制
+    const std::vector<unsigned char>& image_data = *input.image;
+    torch::Tensor normalized_image = image_preprocessor.preprocess(image_data.data(), image_data.size());
     
     // Get predictions
     torch::Tensor probs = target_recognition_model_figure.predict_proba(normalized_image);
@@ -170,6 +351,14 @@ void PredictionSystem::figure_model_recognition(
     for(int i = 0; i < probs_accessor.size(0); i++) {
         figure_probs[i] = probs_accessor[i];
     }
+    input.figure_probs = figure_probs;
+
+    // 写回缓存：句柄的代数保证目标未被移除重建，图像在推理期间被替换或释放时不写入
+    target_manager.modify_target(input.handle, [&](Feature_Store& feature_store) {
+        if (feature_store.get_image_buffer() == input.image) {
+            feature_store.set_figure_probs(figure_probs);
+        }
+    });
 }
 
 bool PredictionSystem::get_fusion_target_recognition(
@@ -177,31 +366,43 @@ bool PredictionSystem::get_fusion_target_recognition(
     int& predicted_class,
     bool& is_fusion
 ) {
-    auto feature_store = target_manager.get_feature_store(target_id);
-    if (!feature_store) {
+    return get_fusion_target_recognition(target_manager.find_target(target_id), predicted_class, is_fusion);
+}
+
+bool PredictionSystem::get_fusion_target_recognition(
+    TargetHandle handle,
+    int& predicted_class,
+    bool& is_fusion
+) {
+    RecognitionInput input;
+    if (!capture_recognition_input(handle, true, true, input)) {
         return false;
     }
+    return fusion_target_recognition(input, predicted_class, is_fusion);
+}
 
+bool PredictionSystem::fusion_target_recognition(
+    RecognitionInput& input,
+    int& predicted_class,
+    bool& is_fusion
+) {
     // 首先检查图像是否准备好
-    if (!feature_store->is_image_initialized()) {
+    if (!input.image_ready) {
         return false;  // 图像未准备好，不进行预测
     }
 
     // 获取图像预测结果
     std::vector<float> figure_probs;
-    figure_model_recognition(target_id, figure_probs);
+    figure_model_recognition(input, figure_probs);
     if (figure_probs.empty()) {
         return false;  // 图像预测失败
     }
 
     // 检查轨迹特征是否准备好
-    bool trace_ready = feature_store->is_track_initialized() && 
-                      feature_store->is_sequence_ready();
-
-    if (trace_ready) {
+    if (input.trace_ready) {
         // 获取轨迹预测结果
         std::vector<float> trace_probs;
-        trace_model_sequence_recognition(target_id, trace_probs);
+        trace_model_sequence_recognition(input, trace_probs);
         if (!trace_probs.empty()) {
             // 两种特征都准备好了，进行融合
             std::vector<float> fused_probs = fuse_recognition_results(figure_probs, trace_probs);
@@ -318,14 +519,80 @@ std::vector<double> PredictionSystem::computeFusion(
 }
 
 
-void PredictionSystem::add_target(int target_id) {
-    target_manager.add_target(target_id);
+TargetHandle PredictionSystem::add_target(int target_id) {
+    return target_manager.add_target(target_id);
+}
+
+TargetHandle PredictionSystem::find_target(int target_id) const {
+    return target_manager.find_target(target_id);
 }
 
 void PredictionSystem::remove_target(int target_id) {
     target_manager.remove_target(target_id);
 }
 
+void PredictionSystem::remove_target(TargetHandle handle) {
+    target_manager.remove_target(handle);
+}
+
+void PredictionSystem::set_target_eviction(int idle_ttl, int max_targets, EvictionCallback callback) {
+    target_manager.set_eviction_policy(idle_ttl, max_targets, std::move(callback));
+}
+
+int PredictionSystem::tick() {
+    return target_manager.tick();
+}
+
+PreprocessReport PredictionSystem::last_preprocess_report() const {
+    return image_preprocessor.last_report();
+}
+
+void PredictionSystem::set_scaled_image_decode(bool enabled) {
+    image_preprocessor.set_scaled_decode(enabled);
+}
+
+void PredictionSystem::set_image_budget(size_t bytes) {
+    target_manager.set_image_budget(bytes);
+}
+
+ImageMemoryStats PredictionSystem::image_memory_stats() const {
+    return target_manager.image_memory_stats();
+}
+
+size_t PredictionSystem::target_memory_bytes(int target_id) const {
+    return target_manager.target_memory_bytes(target_id);
+}
+
+size_t PredictionSystem::total_memory_bytes() const {
+    return target_manager.total_memory_bytes();
+}
+
+void PredictionSystem::enable_async_ingest(int capacity_per_shard, int drain_batch) {
+    if (ingest_queue) {
+        return;
+    }
+    ingest_queue = std::make_unique<IngestQueue>(target_manager, capacity_per_shard, drain_batch);
+    ingest_queue->start();
+}
+
+void PredictionSystem::disable_async_ingest() {
+    if (!ingest_queue) {
+        return;
+    }
+    ingest_queue->stop();
+    ingest_queue.reset();
+}
+
+void PredictionSystem::flush_ingest() {
+    if (ingest_queue) {
+        ingest_queue->flush();
+    }
+}
+
+IngestStats PredictionSystem::ingest_stats() const {
+    return ingest_queue ? ingest_queue->stats() : IngestStats();
+}
+
 bool PredictionSystem::is_ready() const {
     return target_recognition_model_figure.is_model_loaded() && 
            target_recognition_model_trace.is_model_loaded();
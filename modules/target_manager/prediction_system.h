@@ -4,7 +4,9 @@
 #include <string>
 #include <vector>
 #include <torch/torch.h>
+#include <memory>
 #include "target_manager.h"
+#include "ingest_queue.h"
 #include "model_wrapper.h"  
 #include "../preprocessor/data_preprocessor.h" 
 
@@ -19,6 +21,7 @@ private:
     int sequence_length;
     int sequence_stride;
     bool allow_incomplete_sequence;
+    std::unique_ptr<IngestQueue> ingest_queue;  // 异步写入队列，为空表示同步写入；声明在target_manager之后，先于其析构
 
     // 私有辅助函数
     std::vector<std::vector<double>> rescaleEvidence(
@@ -34,6 +37,25 @@ private:
         const std::vector<float>& trace_probs
     );
 
+    // 识别所需的目标数据，在分片锁内复制，图像预处理与模型推理在锁外进行
+    struct RecognitionInput {
+        TargetHandle handle;
+        bool image_ready = false;
+        ImageBuffer image;                  // 待识别的图像，共享不复制；已有概率缓存时为空
+        std::vector<float> figure_probs;    // 当前图像的识别概率缓存
+        bool trace_ready = false;
+        int sequence_length = 0;
+        std::vector<float> sequence;        // 已标准化的轨迹序列 [sequence_length, TRACE_FEATURE_DIM]
+    };
+
+    // 复制目标的识别数据，目标不存在或句柄已失效时返回false
+    bool capture_recognition_input(TargetHandle handle, bool with_image, bool with_trace, RecognitionInput& input);
+
+    // 以下函数作用于已复制的数据，不持有分片锁
+    void figure_model_recognition(RecognitionInput& input, std::vector<float>& figure_probs);
+    void trace_model_sequence_recognition(const RecognitionInput& input, std::vector<float>& trace_probs);
+    bool fusion_target_recognition(RecognitionInput& input, int& predicted_class, bool& is_fusion);
+
 public:
     /**
      * @brief 构造函数
@@ -46,6 +68,9 @@ public:
      * @param target_based_window 目标基准窗口大小
      * @param target_cache_length 目标缓存长度
      * @param device_type 设备类型（CPU/GPU）
+     * @param lazy_sequence 是否仅在识别时才计算轨迹序列特征
+     * @param target_shards 目标管理器的分片数，多个线程并发更新时可设为线程数的数倍
+     * @param preprocess_mode 图像预处理模式，DIAGNOSTIC模式下记录各阶段统计，见last_preprocess_report
      * @throws std::runtime_error 如果模型或参数加载失败
      */
     PredictionSystem(
@@ -60,12 +85,15 @@ public:
         DeviceType device_type,
         int sequence_length = 10,
         int sequence_stride = 1,
-        bool allow_incomplete = false
+        bool allow_incomplete = false,
+        bool lazy_sequence = false,
+        int target_shards = 1,
+        PreprocessMode preprocess_mode = PREPROCESS_PRODUCTION
     );
 
     /**
      * @brief 更新目标轨迹信息
-     * @return 更新是否成功
+     * @return 更新是否成功；异步写入模式下表示是否成功入队
      */
     bool update_info_for_target_trace(
         int target_id,
@@ -76,16 +104,70 @@ public:
     );
 
     /**
-     * @brief 更新目标图像信息
+     * @brief 通过句柄更新目标轨迹信息，不做查找，总是同步写入
+     * @return 句柄已失效时返回false
+     */
+    bool update_info_for_target_trace(
+        TargetHandle handle,
+        double obs_x, double obs_y, double obs_z,
+        double filter_p_x, double filter_p_y, double filter_p_z,
+        double filter_v_x, double filter_v_y, double filter_v_z,
+        double filter_a_x, double filter_a_y, double filter_a_z
+    );
+
+    /**
+     * @brief 一次处理一帧雷达扫描中多个目标的航迹量测，不存在的目标自动添加
+     * @return 更新是否成功；异步写入模式下表示是否成功入队
+     */
+    bool update_info_for_targets_trace(const std::vector<TraceMeasurement>& frame);
+
+    /**
+     * @brief 批量写入单个目标的连续航迹量测（回填/回放），不存在的目标自动添加
+     *        异步写入模式下先等待已排队的量测写入，再同步写入
      * @return 更新是否成功
      */
+    bool update_info_for_target_trace_bulk(
+        int target_id,
+        const std::vector<TraceMeasurement>& measurements
+    );
+
+    /**
+     * @brief 更新目标图像信息
+     *        const引用版本复制一次图像；右值版本接管图像；
+     *        ImageBuffer版本与采集层共享同一份图像，从入队到预处理都不复制
+     * @return 更新是否成功；异步写入模式下表示是否成功入队
+     * @throws std::runtime_error 如果ImageBuffer为空
+     */
     bool update_info_for_target_figure(
         int target_id,
         const std::vector<unsigned char>& image_data
     );
+    bool update_info_for_target_figure(
+        int target_id,
+        std::vector<unsigned char>&& image_data
+    );
+    bool update_info_for_target_figure(
+        int target_id,
+        ImageBuffer image_data
+    );
+
+    // 句柄版本，句柄已失效时返回false
+    bool update_info_for_target_figure(
+        TargetHandle handle,
+        const std::vector<unsigned char>& image_data
+    );
+    bool update_info_for_target_figure(
+        TargetHandle handle,
+        std::vector<unsigned char>&& image_data
+    );
+    bool update_info_for_target_figure(
+        TargetHandle handle,
+        ImageBuffer image_data
+    );
 
     /**
      * @brief 使用图像模型进行目标识别
+     *        只在复制图像缓冲区和写回概率缓存时持有分片锁，预处理与推理期间其他线程可以更新目标
      * @param[out] figure_probs 输出的图像识别概率
      * @throws std::runtime_error 如果目标不存在或未初始化
      */
@@ -93,6 +175,10 @@ public:
         int target_id,
         std::vector<float>& figure_probs
     );
+    void figure_model_recognition(
+        TargetHandle handle,
+        std::vector<float>& figure_probs
+    );
 
     /**
      * @brief 获取目标预测结果
@@ -111,6 +197,11 @@ public:
         int& predicted_class,
         bool& is_fusion
     );
+    bool get_fusion_target_recognition(
+        TargetHandle handle,
+        int& predicted_class,
+        bool& is_fusion
+    );
 
     /**
      * 使用序列数据进行轨迹识别
@@ -121,11 +212,71 @@ public:
         int target_id,
         std::vector<float>& trace_probs
     );
+    void trace_model_sequence_recognition(
+        TargetHandle handle,
+        std::vector<float>& trace_probs
+    );
 
-    // 目标管理函数
-    void add_target(int target_id);
+    // 目标管理函数，句柄在目标移除前一直有效，可代替目标ID避免重复查找
+    TargetHandle add_target(int target_id);
+    TargetHandle find_target(int target_id) const;
     void remove_target(int target_id);
+    void remove_target(TargetHandle handle);
     
+    /**
+     * @brief 设置目标的自动移除：空闲超过idle_ttl个时钟单位或目标数超过max_targets时移除，0表示不限
+     * @param callback 目标被移除后的回调，可以为空
+     */
+    void set_target_eviction(int idle_ttl, int max_targets, EvictionCallback callback = nullptr);
+
+    /**
+     * @brief 时钟前进一个单位（通常每帧调用一次），移除空闲超时的目标
+     * @return 本次移除的目标数
+     */
+    int tick();
+
+    /**
+     * @brief 设置全部目标原始图像的内存上限（字节），0表示不限
+     *        超出上限时按最近写入顺序释放图像，已识别的目标保留识别概率代替图像
+     */
+    void set_image_budget(size_t bytes);
+
+    // 图像内存统计
+    ImageMemoryStats image_memory_stats() const;
+
+    // 单个目标占用的内存字节数，目标不存在时返回0
+    size_t target_memory_bytes(int target_id) const;
+
+    // 全部目标占用的内存字节数
+    size_t total_memory_bytes() const;
+
+    /**
+     * @brief 开启异步写入：按目标ID更新航迹、图像的函数只把量测放入无锁队列，
+     *        由后台线程成批写入目标；队列满时丢弃量测并返回false
+     *        识别结果反映已写入的量测，需要立即可见时先调用flush_ingest
+     * @param capacity_per_shard 每个分片队列的容量
+     * @param drain_batch 后台线程每个分片每轮最多写入的量测个数
+     */
+    void enable_async_ingest(int capacity_per_shard = 4096, int drain_batch = 256);
+
+    // 关闭异步写入，写完已排队的量测后恢复同步写入
+    void disable_async_ingest();
+
+    // 等待已入队的量测全部写入目标
+    void flush_ingest();
+
+    // 异步写入队列的深度、丢弃数与延迟，未开启时全为0
+    IngestStats ingest_stats() const;
+
+    // 最近一次图像预处理的诊断报告，仅DIAGNOSTIC模式下记录
+    PreprocessReport last_preprocess_report() const;
+
+    /**
+     * @brief 大尺寸JPEG是否在DCT域缩小解码，默认关闭
+     *        更快但与全分辨率解码的结果存在误差，见ImagePreprocessor::set_scaled_decode
+     */
+    void set_scaled_image_decode(bool enabled);
+
     /**
      * @brief 检查系统是否准备就绪
      * @return 如果所有模型都已加载则返回true
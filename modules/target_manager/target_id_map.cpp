@@ -0,0 +1,76 @@
+#include "target_id_map.h"
+
+TargetIdMap::TargetIdMap(std::size_t initial_capacity) {
+    std::size_t capacity = 8;
+    while (capacity < initial_capacity) {
+        capacity <<= 1;
+    }
+    entries.assign(capacity, Entry{0, NOT_FOUND});
+    mask = capacity - 1;
+}
+
+void TargetIdMap::rehash(std::size_t new_capacity) {
+    std::vector<Entry> old_entries(new_capacity, Entry{0, NOT_FOUND});
+    old_entries.swap(entries);
+    mask = new_capacity - 1;
+    count = 0;
+    for (const Entry& entry : old_entries) {
+        if (entry.value != NOT_FOUND) {
+            insert(entry.key, entry.value);
+        }
+    }
+}
+
+void TargetIdMap::insert(int key, int value) {
+    if ((count + 1) * 4 > entries.size() * 3) {
+        rehash(entries.size() * 2);
+    }
+    for (std::size_t i = home(key); ; i = (i + 1) & mask) {
+        Entry& entry = entries[i];
+        if (entry.value == NOT_FOUND) {
+            entry.key = key;
+            entry.value = value;
+            ++count;
+            return;
+        }
+        if (entry.key == key) {
+            entry.value = value;
+            return;
+        }
+    }
+}
+
+bool TargetIdMap::erase(int key) {
+    std::size_t i = home(key);
+    while (true) {
+        if (entries[i].value == NOT_FOUND) {
+            return false;
+        }
+        if (entries[i].key == key) {
+            break;
+        }
+        i = (i + 1) & mask;
+    }
+
+    // 后移法：把探测链上后续可以前移的条目填入空位，保持查找不被空位截断
+    std::size_t hole = i;
+    for (std::size_t j = (hole + 1) & mask; entries[j].value != NOT_FOUND; j = (j + 1) & mask) {
+        std::size_t want = home(entries[j].key);
+        // want 不在 (hole, j] 的循环区间内时，条目 j 可以移到 hole
+        bool in_between = (hole < j) ? (want > hole && want <= j) : (want > hole || want <= j);
+        if (!in_between) {
+            entries[hole] = entries[j];
+            hole = j;
+        }
+    }
+    entries[hole].value = NOT_FOUND;
+    --count;
+    return true;
+}
+
+void TargetIdMap::clear() {
+    for (Entry& entry : entries) {
+        entry.value = NOT_FOUND;
+    }
+    count = 0;
+}
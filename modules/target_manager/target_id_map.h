@@ -0,0 +1,76 @@
+#ifndef TARGET_ID_MAP_H
+#define TARGET_ID_MAP_H
+
+#include <cstddef>
+#include <vector>
+
+/**
+ * 目标ID到槽位下标的开放寻址哈希表
+ * 线性探测，容量为2的幂，负载超过3/4时扩容；删除采用后移法，不留墓碑
+ * 全部条目存放在一段连续数组中，插入删除不做逐节点的内存分配
+ */
+class TargetIdMap {
+public:
+    static constexpr int NOT_FOUND = -1;
+
+private:
+    struct Entry {
+        int key;
+        int value;   // 槽位下标，NOT_FOUND 表示空位
+    };
+
+    std::vector<Entry> entries;
+    std::size_t count = 0;
+    std::size_t mask = 0;
+
+    std::size_t home(int key) const {
+        // Fibonacci 散列，连续的目标ID也能均匀分布
+        return static_cast<std::size_t>(
+            (static_cast<unsigned long long>(static_cast<unsigned int>(key)) * 0x9E3779B97F4A7C15ULL) >> 32
+        ) & mask;
+    }
+
+    void rehash(std::size_t new_capacity);
+
+public:
+    explicit TargetIdMap(std::size_t initial_capacity = 16);
+
+    /**
+     * 查找目标对应的槽位
+     * @return 槽位下标，不存在时返回 NOT_FOUND
+     */
+    int find(int key) const {
+        for (std::size_t i = home(key); ; i = (i + 1) & mask) {
+            const Entry& entry = entries[i];
+            if (entry.value == NOT_FOUND) {
+                return NOT_FOUND;
+            }
+            if (entry.key == key) {
+                return entry.value;
+            }
+        }
+    }
+
+    // 插入或覆盖，value 必须非负
+    void insert(int key, int value);
+
+    // 删除，返回是否存在
+    bool erase(int key);
+
+    // 清空全部条目，保留容量
+    void clear();
+
+    std::size_t size() const { return count; }
+
+    // 按数组顺序访问全部条目
+    template <typename Visitor>
+    void for_each(Visitor visit) const {
+        for (const Entry& entry : entries) {
+            if (entry.value != NOT_FOUND) {
+                visit(entry.key, entry.value);
+            }
+        }
+    }
+};
+
+#endif
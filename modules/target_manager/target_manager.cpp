@@ -1,45 +1,436 @@
 #include "target_manager.h"
+#include <algorithm>
 #include <stdexcept>
+#include <utility>
+
+TargetManager::TargetShard::TargetShard(
+    double deltaT,
+    int based_window,
+    int cache_length,
+    int max_sequence_length,
+    int smooth_window,
+    bool lazy_sequence
+) : store_pool(deltaT, based_window, cache_length, max_sequence_length, smooth_window, lazy_sequence)
+{
+}
 
 TargetManager::TargetManager(
     double deltaT,
     int based_window,
     int cache_length,
-    int max_sequence_length
-) : deltaT(deltaT),
+    int max_sequence_length,
+    int smooth_window,
+    bool lazy_sequence,
+    int num_shards
+) : shard_bits(0),
+    deltaT(deltaT),
     based_window(based_window),
-    cache_length(cache_length)
+    cache_length(cache_length),
+    max_sequence_length(max_sequence_length),
+    smooth_window(smooth_window),
+    lazy_sequence(lazy_sequence),
+    clock(0)
 {
+    if (num_shards < 1) {
+        throw std::runtime_error("Invalid shard count: " + std::to_string(num_shards));
+    }
+    while ((1 << shard_bits) < num_shards) {
+        ++shard_bits;
+    }
+    for (int i = 0; i < (1 << shard_bits); ++i) {
+        shards.push_back(std::make_unique<TargetShard>(
+            deltaT, based_window, cache_length, max_sequence_length, smooth_window, lazy_sequence
+        ));
+    }
+}
+
+TargetHandle TargetManager::add_target_locked(TargetShard& shard, int shard_id, int target_id) {
+    int existing = shard.target_slots.find(target_id);
+    if (existing != TargetIdMap::NOT_FOUND) {
+        return TargetHandle{existing, shard.slots[existing].generation, shard_id}; // 目标已存在
+    }
+
+    int slot;
+    if (!shard.free_slots.empty()) {
+        slot = shard.free_slots.back();
+        shard.free_slots.pop_back();
+    } else {
+        slot = static_cast<int>(shard.slots.size());
+        shard.slots.emplace_back();
+    }
+
+    // 新构造的对象需要设置标准化参数，复用的对象reset后仍保留
+    bool fresh = slot >= shard.store_pool.constructed();
+    Feature_Store* feature_store;
+    try {
+        feature_store = shard.store_pool.obtain(slot);
+        if (fresh && !shard.feature_mean.empty()) {
+            feature_store->set_feature_normalization(shard.feature_mean, shard.feature_scale);
+        }
+    } catch (...) {
+        // 归还槽位，保持slots与store_pool中已构造的对象一一对应
+        if (slot < shard.store_pool.constructed()) {
+            shard.free_slots.push_back(slot);
+        } else {
+            shard.slots.pop_back();
+        }
+        throw;
+    }
+
+    TargetSlot& entry = shard.slots[slot];
+    entry.store = feature_store;
+    entry.target_id = target_id;
+    shard.target_slots.insert(target_id, slot);
+    touch_locked(shard, slot);
+    if (idle_ttl > 0) {
+        shard.wheel.schedule(slot, entry.last_touch + idle_ttl);
+    }
+    return TargetHandle{slot, entry.generation, shard_id};
+}
+
+void TargetManager::touch_locked(TargetShard& shard, int slot) {
+    TargetSlot& entry = shard.slots[slot];
+    // 时间轮中的到期时间不在此处更新，到期时按last_touch重新定时
+    entry.last_touch = clock.load(std::memory_order_relaxed);
+    if (shard.lru_head == slot) {
+        return;
+    }
+    lru_unlink_locked(shard, slot);
+    entry.lru_next = shard.lru_head;
+    if (shard.lru_head >= 0) {
+        shard.slots[shard.lru_head].lru_prev = slot;
+    }
+    shard.lru_head = slot;
+    if (shard.lru_tail < 0) {
+        shard.lru_tail = slot;
+    }
+}
+
+void TargetManager::lru_unlink_locked(TargetShard& shard, int slot) {
+    TargetSlot& entry = shard.slots[slot];
+    if (entry.lru_prev >= 0) {
+        shard.slots[entry.lru_prev].lru_next = entry.lru_next;
+    } else if (shard.lru_head == slot) {
+        shard.lru_head = entry.lru_next;
+    }
+    if (entry.lru_next >= 0) {
+        shard.slots[entry.lru_next].lru_prev = entry.lru_prev;
+    } else if (shard.lru_tail == slot) {
+        shard.lru_tail = entry.lru_prev;
+    }
+    entry.lru_prev = -1;
+    entry.lru_next = -1;
+}
+
+void TargetManager::release_slot_locked(TargetShard& shard, int slot) {
+    TargetSlot& entry = shard.slots[slot];
+    shard.target_slots.erase(entry.target_id);
+    shard.wheel.cancel(slot);
+    lru_unlink_locked(shard, slot);
+    // 图像不等到槽位复用时才释放，以免已移除的目标继续占用图像内存
+    if (entry.image_bytes > 0) {
+        shard.image_bytes -= entry.image_bytes;
+        --shard.image_count;
+        entry.image_bytes = 0;
+        image_unlink_locked(shard, slot);
+    }
+    entry.store->release_image();
+    entry.store = nullptr;   // 对象留在对象池中，槽位再次使用时reset
+    entry.target_id = -1;
+    entry.generation = entry.generation + 1;  // 使旧句柄失效
+    shard.free_slots.push_back(slot);
+}
+
+void TargetManager::enforce_capacity_locked(TargetShard& shard, std::vector<int>& evicted) {
+    if (shard_capacity <= 0) {
+        return;
+    }
+    while (static_cast<int>(shard.target_slots.size()) > shard_capacity) {
+        int slot = shard.lru_tail;
+        evicted.push_back(shard.slots[slot].target_id);
+        release_slot_locked(shard, slot);
+    }
+}
+
+void TargetManager::image_unlink_locked(TargetShard& shard, int slot) {
+    TargetSlot& entry = shard.slots[slot];
+    if (entry.image_prev >= 0) {
+        shard.slots[entry.image_prev].image_next = entry.image_next;
+    } else if (shard.image_head == slot) {
+        shard.image_head = entry.image_next;
+    }
+    if (entry.image_next >= 0) {
+        shard.slots[entry.image_next].image_prev = entry.image_prev;
+    } else if (shard.image_tail == slot) {
+        shard.image_tail = entry.image_prev;
+    }
+    entry.image_prev = -1;
+    entry.image_next = -1;
+}
+
+void TargetManager::update_image_locked(TargetShard& shard, int slot, ImageBuffer image_data) {
+    TargetSlot& entry = shard.slots[slot];
+    touch_locked(shard, slot);
+    entry.store->update_image(std::move(image_data));
+
+    // 按对象实际持有的字节数记账，modify_target中直接写入的图像也会在此得到修正
+    size_t bytes = entry.store->image_bytes();
+    if (entry.image_bytes > 0) {
+        shard.image_bytes -= entry.image_bytes;
+        --shard.image_count;
+        image_unlink_locked(shard, slot);
+    }
+    entry.image_bytes = bytes;
+    if (bytes > 0) {
+        shard.image_bytes += bytes;
+        ++shard.image_count;
+        entry.image_next = shard.image_head;
+        if (shard.image_head >= 0) {
+            shard.slots[shard.image_head].image_prev = slot;
+        }
+        shard.image_head = slot;
+        if (shard.image_tail < 0) {
+            shard.image_tail = slot;
+        }
+    }
+    enforce_image_budget_locked(shard, slot);
+}
+
+void TargetManager::release_image_locked(TargetShard& shard, int slot) {
+    TargetSlot& entry = shard.slots[slot];
+    if (entry.store->has_figure_probs()) {
+        ++shard.images_replaced;
+    } else {
+        ++shard.images_dropped;
+    }
+    entry.store->release_image();
+    shard.image_bytes -= entry.image_bytes;
+    --shard.image_count;
+    entry.image_bytes = 0;
+    image_unlink_locked(shard, slot);
+}
+
+void TargetManager::enforce_image_budget_locked(TargetShard& shard, int keep_slot) {
+    if (shard_image_budget == 0) {
+        return;
+    }
+    while (shard.image_bytes > shard_image_budget && shard.image_tail >= 0 && shard.image_tail != keep_slot) {
+        release_image_locked(shard, shard.image_tail);
+    }
+}
+
+void TargetManager::set_image_budget(size_t bytes) {
+    size_t num_shards = shards.size();
+    image_budget = bytes;
+    shard_image_budget = bytes > 0 ? (bytes + num_shards - 1) / num_shards : 0;
+    for (auto& shard : shards) {
+        std::unique_lock<std::shared_mutex> lock(shard->mutex);
+        // 保留最近写入的一张图像，与写入时的规则一致
+        enforce_image_budget_locked(*shard, shard->image_head);
+    }
+}
+
+ImageMemoryStats TargetManager::image_memory_stats() const {
+    ImageMemoryStats stats;
+    stats.budget = image_budget;
+    for (const auto& shard : shards) {
+        std::shared_lock<std::shared_mutex> lock(shard->mutex);
+        stats.image_bytes += shard->image_bytes;
+        stats.images += shard->image_count;
+        stats.replaced += shard->images_replaced;
+        stats.dropped += shard->images_dropped;
+    }
+    return stats;
+}
+
+size_t TargetManager::target_memory_bytes(int target_id) const {
+    const TargetShard& shard = shard_of(target_id);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    int slot = shard.target_slots.find(target_id);
+    if (slot == TargetIdMap::NOT_FOUND) {
+        return 0;
+    }
+    return shard.slots[slot].store->memory_usage();
+}
+
+size_t TargetManager::total_memory_bytes() const {
+    size_t bytes = 0;
+    for (const auto& shard : shards) {
+        std::shared_lock<std::shared_mutex> lock(shard->mutex);
+        for (int slot = 0; slot < shard->store_pool.constructed(); ++slot) {
+            bytes += shard->store_pool.at(slot)->memory_usage();
+        }
+        bytes += shard->slots.capacity() * sizeof(TargetSlot);
+    }
+    return bytes;
+}
+
+void TargetManager::notify_evicted(const std::vector<int>& target_ids, EvictionReason reason) {
+    if (!eviction_callback) {
+        return;
+    }
+    for (int target_id : target_ids) {
+        eviction_callback(target_id, reason);
+    }
+}
+
+void TargetManager::set_eviction_policy(int idle_ttl, int max_targets, EvictionCallback callback) {
+    if (idle_ttl < 0 || max_targets < 0) {
+        throw std::runtime_error("Invalid eviction policy");
+    }
+    this->idle_ttl = static_cast<unsigned long long>(idle_ttl);
+    this->max_targets = max_targets;
+    int num_shards = static_cast<int>(shards.size());
+    shard_capacity = max_targets > 0 ? (max_targets + num_shards - 1) / num_shards : 0;
+    eviction_callback = std::move(callback);
+
+    std::vector<int> evicted;
+    for (auto& shard : shards) {
+        std::unique_lock<std::shared_mutex> lock(shard->mutex);
+        for (int slot = 0; slot < static_cast<int>(shard->slots.size()); ++slot) {
+            if (!shard->slots[slot].store) {
+                continue;
+            }
+            if (this->idle_ttl > 0) {
+                shard->wheel.schedule(slot, shard->slots[slot].last_touch + this->idle_ttl);
+            } else {
+                shard->wheel.cancel(slot);
+            }
+        }
+        enforce_capacity_locked(*shard, evicted);
+    }
+    notify_evicted(evicted, EVICT_CAPACITY);
+}
+
+int TargetManager::tick(unsigned long long ticks) {
+    unsigned long long now = clock.fetch_add(ticks, std::memory_order_relaxed) + ticks;
+    std::vector<int> evicted;
+    int total = 0;
+    for (auto& shard : shards) {
+        evicted.clear();
+        {
+            std::unique_lock<std::shared_mutex> lock(shard->mutex);
+            shard->wheel.advance(now, [&](int slot) {
+                TargetSlot& entry = shard->slots[slot];
+                unsigned long long deadline = entry.last_touch + idle_ttl;
+                if (deadline > now) {
+                    shard->wheel.schedule(slot, deadline);  // 期间有更新，按最近更新时间重新定时
+                    return;
+                }
+                evicted.push_back(entry.target_id);
+                release_slot_locked(*shard, slot);
+            });
+        }
+        total += static_cast<int>(evicted.size());
+        notify_evicted(evicted, EVICT_IDLE);
+    }
+    return total;
+}
+
+Feature_Store* TargetManager::find_store_locked(const TargetShard& shard, TargetHandle handle) const {
+    if (handle.slot < 0 || handle.slot >= static_cast<int>(shard.slots.size())) {
+        return nullptr;
+    }
+    const TargetSlot& entry = shard.slots[handle.slot];
+    return entry.generation == handle.generation ? entry.store : nullptr;
+}
+
+TargetHandle TargetManager::add_target(int target_id) {
+    int shard_id = shard_index(target_id);
+    TargetShard& shard = *shards[shard_id];
+    std::vector<int> evicted;
+    TargetHandle handle;
+    {
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        handle = add_target_locked(shard, shard_id, target_id);
+        enforce_capacity_locked(shard, evicted);
+    }
+    notify_evicted(evicted, EVICT_CAPACITY);
+    return handle;
+}
+
+TargetHandle TargetManager::find_target(int target_id) const {
+    int shard_id = shard_index(target_id);
+    const TargetShard& shard = *shards[shard_id];
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    int slot = shard.target_slots.find(target_id);
+    if (slot == TargetIdMap::NOT_FOUND) {
+        return TargetHandle();
+    }
+    return TargetHandle{slot, shard.slots[slot].generation, shard_id};
+}
+
+void TargetManager::set_feature_normalization(
+    const std::vector<double>& mean,
+    const std::vector<double>& scale
+) {
+    for (auto& shard : shards) {
+        std::unique_lock<std::shared_mutex> lock(shard->mutex);
+        // 空闲槽位上的对象也一并设置，复用时无需再设
+        for (int slot = 0; slot < shard->store_pool.constructed(); ++slot) {
+            shard->store_pool.at(slot)->set_feature_normalization(mean, scale);
+        }
+        shard->feature_mean = mean;
+        shard->feature_scale = scale;
+    }
 }
 
-void TargetManager::add_target(int target_id) {
-    if (target_stores.find(target_id) != target_stores.end()) {
-        //add log 
-        return; // 目标已存在
+void TargetManager::set_angle_mode(AngleMode mode) {
+    std::lock_guard<std::mutex> query_lock(query_mutex);
+    query_engine.set_angle_mode(mode);
+    for (auto& shard : shards) {
+        std::unique_lock<std::shared_mutex> lock(shard->mutex);
+        shard->angle_mode = mode;
+        for (auto& chunk : shard->frame_chunks) {
+            chunk->engine.set_angle_mode(mode);
+        }
     }
-    
-    target_stores[target_id] = std::make_unique<Feature_Store>(
-        deltaT,
-        based_window,
-        cache_length,
-        max_sequence_length
-    );
 }
 
 void TargetManager::remove_target(int target_id) {
-    target_stores.erase(target_id);
+    TargetShard& shard = shard_of(target_id);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    int slot = shard.target_slots.find(target_id);
+    if (slot == TargetIdMap::NOT_FOUND) {
+        return;
+    }
+    release_slot_locked(shard, slot);
+}
+
+void TargetManager::remove_target(TargetHandle handle) {
+    if (handle.shard < 0 || handle.shard >= static_cast<int>(shards.size())) {
+        return;
+    }
+    TargetShard& shard = *shards[handle.shard];
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    if (!find_store_locked(shard, handle)) {
+        return;
+    }
+    release_slot_locked(shard, handle.slot);
 }
 
 bool TargetManager::has_target(int target_id) const {
-    return target_stores.find(target_id) != target_stores.end();
+    const TargetShard& shard = shard_of(target_id);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    return shard.target_slots.find(target_id) != TargetIdMap::NOT_FOUND;
 }
 
 Feature_Store* TargetManager::get_feature_store(int target_id) {
-    auto it = target_stores.find(target_id);
-    if (it == target_stores.end()) {
+    TargetShard& shard = shard_of(target_id);
+    int slot = shard.target_slots.find(target_id);
+    if (slot == TargetIdMap::NOT_FOUND) {
         return nullptr;
     }
-    return it->second.get();
+    return shard.slots[slot].store;
+}
+
+int TargetManager::target_count() const {
+    int count = 0;
+    for (const auto& shard : shards) {
+        std::shared_lock<std::shared_mutex> lock(shard->mutex);
+        count += static_cast<int>(shard->target_slots.size());
+    }
+    return count;
 }
 
 void TargetManager::update_target_trace(
@@ -49,48 +440,375 @@ void TargetManager::update_target_trace(
     double filter_v_x, double filter_v_y, double filter_v_z,
     double filter_a_x, double filter_a_y, double filter_a_z
 ) {
-    auto feature_store = get_feature_store(target_id);
-    if (!feature_store) {
+    bool found = update_target(target_id, [&](Feature_Store& feature_store) {
+        feature_store.update(
+            obs_x, obs_y, obs_z,
+            filter_p_x, filter_p_y, filter_p_z,
+            filter_v_x, filter_v_y, filter_v_z,
+            filter_a_x, filter_a_y, filter_a_z
+        );
+    });
+    if (!found) {
+        throw std::runtime_error("Target ID not found: " + std::to_string(target_id));
+    }
+}
+
+void TargetManager::update_target_trace(
+    TargetHandle handle,
+    double obs_x, double obs_y, double obs_z,
+    double filter_p_x, double filter_p_y, double filter_p_z,
+    double filter_v_x, double filter_v_y, double filter_v_z,
+    double filter_a_x, double filter_a_y, double filter_a_z
+) {
+    bool found = update_target(handle, [&](Feature_Store& feature_store) {
+        feature_store.update(
+            obs_x, obs_y, obs_z,
+            filter_p_x, filter_p_y, filter_p_z,
+            filter_v_x, filter_v_y, filter_v_z,
+            filter_a_x, filter_a_y, filter_a_z
+        );
+    });
+    if (!found) {
+        throw std::runtime_error("Stale target handle: slot " + std::to_string(handle.slot));
+    }
+}
+
+void TargetManager::update_targets_trace(const std::vector<TraceMeasurement>& frame, bool add_missing) {
+    int frame_size = static_cast<int>(frame.size());
+    if (frame_size == 0) {
+        return;
+    }
+
+    // 按分片对量测下标做计数排序，分片内保持帧内顺序
+    thread_local std::vector<int> shard_begin;
+    thread_local std::vector<int> frame_shard;
+    thread_local std::vector<int> order;
+    int num_shards = static_cast<int>(shards.size());
+    shard_begin.assign(num_shards + 1, 0);
+    frame_shard.resize(frame_size);
+    order.resize(frame_size);
+    for (int i = 0; i < frame_size; ++i) {
+        frame_shard[i] = shard_index(frame[i].target_id);
+        ++shard_begin[frame_shard[i] + 1];
+    }
+    for (int s = 0; s < num_shards; ++s) {
+        shard_begin[s + 1] += shard_begin[s];
+    }
+    for (int i = 0; i < frame_size; ++i) {
+        order[shard_begin[frame_shard[i]]++] = i;
+    }
+    // 经过上面的填充，shard_begin[s] 已前移为分片s的结束位置
+    for (int s = num_shards; s > 0; --s) {
+        shard_begin[s] = shard_begin[s - 1];
+    }
+    shard_begin[0] = 0;
+
+    thread_local std::vector<int> active_shards;
+    active_shards.clear();
+    for (int s = 0; s < num_shards; ++s) {
+        if (shard_begin[s + 1] > shard_begin[s]) {
+            active_shards.push_back(s);
+        }
+    }
+
+    if (!worker_pool) {
+        // 先检查全部目标，避免更新到一半时才发现帧内有不存在的目标
+        // 单分片时update_shard_frame在更新前已做同样的检查
+        if (!add_missing && num_shards > 1) {
+            for (int s : active_shards) {
+                const TargetShard& shard = *shards[s];
+                std::shared_lock<std::shared_mutex> lock(shard.mutex);
+                for (int k = shard_begin[s]; k < shard_begin[s + 1]; ++k) {
+                    int target_id = frame[order[k]].target_id;
+                    if (shard.target_slots.find(target_id) == TargetIdMap::NOT_FOUND) {
+                        throw std::runtime_error("Target ID not found: " + std::to_string(target_id));
+                    }
+                }
+            }
+        }
+        for (int s : active_shards) {
+            update_shard_frame(s, frame, order.data() + shard_begin[s], shard_begin[s + 1] - shard_begin[s], add_missing);
+        }
+        return;
+    }
+
+    // 并行模式：按分片号升序加写锁，其他函数同一时刻只持有一个分片的锁，不会死锁
+    // 全部分片解析成功后才开始更新，帧内有不存在的目标时整帧拒绝
+    std::vector<std::unique_lock<std::shared_mutex>> locks;
+    locks.reserve(active_shards.size());
+    for (int s : active_shards) {
+        locks.emplace_back(shards[s]->mutex);
+        resolve_shard_frame_locked(*shards[s], s, frame, order.data() + shard_begin[s],
+                                   shard_begin[s + 1] - shard_begin[s], add_missing);
+    }
+    // 帧内重复的量测和最近更新链表在调用线程中处理，之后每个块只访问自己的目标
+    thread_local std::vector<std::pair<int, int>> chunk_tasks;
+    chunk_tasks.clear();
+    for (int s : active_shards) {
+        int chunks = prepare_frame_chunks_locked(*shards[s], frame, order.data() + shard_begin[s],
+                                                 shard_begin[s + 1] - shard_begin[s]);
+        for (int c = 0; c < chunks; ++c) {
+            chunk_tasks.emplace_back(s, c);
+        }
+    }
+    // thread_local变量在其他线程中是另一份，先取出调用线程的数据
+    const std::pair<int, int>* tasks = chunk_tasks.data();
+    const int* begins = shard_begin.data();
+    const int* indices = order.data();
+    auto run_chunk = [&](int task) {
+        int s = tasks[task].first;
+        update_frame_chunk(*shards[s], frame, indices + begins[s], tasks[task].second);
+    };
+    if (chunk_tasks.size() < 2) {
+        for (int task = 0; task < static_cast<int>(chunk_tasks.size()); ++task) {
+            run_chunk(task);
+        }
+    } else {
+        worker_pool->run(static_cast<int>(chunk_tasks.size()), run_chunk);
+    }
+
+    std::vector<int> evicted;
+    for (int s : active_shards) {
+        enforce_capacity_locked(*shards[s], evicted);
+    }
+    locks.clear();
+    notify_evicted(evicted, EVICT_CAPACITY);
+}
+
+void TargetManager::set_parallel_workers(int threads) {
+    if (threads <= 1) {
+        worker_pool.reset();
+    } else {
+        worker_pool = std::make_unique<WorkStealingPool>(threads);
+    }
+}
+
+void TargetManager::update_shard_frame(
+    int shard_id,
+    const std::vector<TraceMeasurement>& frame,
+    const int* indices,
+    int count,
+    bool add_missing
+) {
+    TargetShard& shard = *shards[shard_id];
+    std::vector<int> evicted;
+    {
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        resolve_shard_frame_locked(shard, shard_id, frame, indices, count, add_missing);
+        int chunks = prepare_frame_chunks_locked(shard, frame, indices, count);
+        for (int c = 0; c < chunks; ++c) {
+            update_frame_chunk(shard, frame, indices, c);
+        }
+        // 帧内新增的目标处理完之后再检查上限，避免移除本帧还要写入的目标
+        enforce_capacity_locked(shard, evicted);
+    }
+    notify_evicted(evicted, EVICT_CAPACITY);
+}
+
+void TargetManager::resolve_shard_frame_locked(
+    TargetShard& shard,
+    int shard_id,
+    const std::vector<TraceMeasurement>& frame,
+    const int* indices,
+    int count,
+    bool add_missing
+) {
+    // 先解析全部目标，避免更新到一半时抛出异常，之后不再查找
+    shard.batch_last_index.clear();
+    shard.frame_slots.resize(count);
+    for (int k = 0; k < count; ++k) {
+        int target_id = frame[indices[k]].target_id;
+        shard.frame_slots[k] = shard.target_slots.find(target_id);
+        if (shard.frame_slots[k] == TargetIdMap::NOT_FOUND && !add_missing) {
+            throw std::runtime_error("Target ID not found: " + std::to_string(target_id));
+        }
+        shard.batch_last_index.insert(target_id, k);
+    }
+    if (add_missing) {
+        for (int k = 0; k < count; ++k) {
+            if (shard.frame_slots[k] == TargetIdMap::NOT_FOUND) {
+                // 同一新目标在帧内出现多次时只添加一次
+                shard.frame_slots[k] = add_target_locked(shard, shard_id, frame[indices[k]].target_id).slot;
+            }
+        }
+    }
+}
+
+int TargetManager::prepare_frame_chunks_locked(
+    TargetShard& shard,
+    const std::vector<TraceMeasurement>& frame,
+    const int* indices,
+    int count
+) {
+    // 同一目标在帧内出现多次时，前面的量测在这里按顺序逐个更新，最后一次留给所在的块
+    shard.frame_targets.clear();
+    for (int k = 0; k < count; ++k) {
+        const TraceMeasurement& m = frame[indices[k]];
+        touch_locked(shard, shard.frame_slots[k]);
+        if (shard.batch_last_index.find(m.target_id) == k) {
+            shard.frame_targets.push_back(k);
+            continue;
+        }
+        shard.slots[shard.frame_slots[k]].store->update(
+            m.obs[0], m.obs[1], m.obs[2],
+            m.filter_p[0], m.filter_p[1], m.filter_p[2],
+            m.filter_v[0], m.filter_v[1], m.filter_v[2],
+            m.filter_a[0], m.filter_a[1], m.filter_a[2]
+        );
+    }
+
+    int chunks = (static_cast<int>(shard.frame_targets.size()) + FRAME_CHUNK_TARGETS - 1) / FRAME_CHUNK_TARGETS;
+    while (static_cast<int>(shard.frame_chunks.size()) < chunks) {
+        shard.frame_chunks.push_back(std::make_unique<TargetShard::FrameChunk>());
+        shard.frame_chunks.back()->engine.set_angle_mode(shard.angle_mode);
+    }
+    return chunks;
+}
+
+void TargetManager::update_frame_chunk(
+    TargetShard& shard,
+    const std::vector<TraceMeasurement>& frame,
+    const int* indices,
+    int chunk
+) {
+    TargetShard::FrameChunk& scratch = *shard.frame_chunks[chunk];
+    const int* positions = shard.frame_targets.data() + chunk * FRAME_CHUNK_TARGETS;
+    int count = std::min(FRAME_CHUNK_TARGETS, static_cast<int>(shard.frame_targets.size()) - chunk * FRAME_CHUNK_TARGETS);
+
+    scratch.engine.clear();
+    scratch.stores.clear();
+    for (int j = 0; j < count; ++j) {
+        const TraceMeasurement& m = frame[indices[positions[j]]];
+        Feature_Store* feature_store = shard.slots[shard.frame_slots[positions[j]]].store;
+        // 预取：下下个目标的对象本身，下一个目标将要写入的航迹槽位
+        if (j + 2 < count) {
+#if defined(__GNUC__)
+            __builtin_prefetch(shard.slots[shard.frame_slots[positions[j + 2]]].store);
+#endif
+        }
+        if (j + 1 < count) {
+            shard.slots[shard.frame_slots[positions[j + 1]]].store->prefetch_update();
+        }
+        bool derived = feature_store->update_track(
+            m.obs[0], m.obs[1], m.obs[2],
+            m.filter_p[0], m.filter_p[1], m.filter_p[2],
+            m.filter_v[0], m.filter_v[1], m.filter_v[2],
+            m.filter_a[0], m.filter_a[1], m.filter_a[2]
+        );
+        if (derived) {
+            scratch.engine.add(feature_store->get_trace_input(feature_store->get_smooth_window(), 0));
+            scratch.stores.push_back(feature_store);
+        }
+    }
+
+    if (scratch.stores.empty()) {
+        return;
+    }
+    scratch.features.resize(scratch.stores.size() * TRACE_FEATURE_DIM);
+    scratch.engine.compute(scratch.features.data());
+    for (size_t i = 0; i < scratch.stores.size(); ++i) {
+        scratch.stores[i]->push_sequence_features(scratch.features.data() + i * TRACE_FEATURE_DIM);
+    }
+}
+
+void TargetManager::update_target_trace_bulk(int target_id, const TraceMeasurement* measurements, int count) {
+    bool found = update_target(target_id, [&](Feature_Store& feature_store) {
+        feature_store.update_bulk(measurements, count);
+    });
+    if (!found) {
         throw std::runtime_error("Target ID not found: " + std::to_string(target_id));
     }
-    
-    feature_store->update(
-        obs_x, obs_y, obs_z,
-        filter_p_x, filter_p_y, filter_p_z,
-        filter_v_x, filter_v_y, filter_v_z,
-        filter_a_x, filter_a_y, filter_a_z
-    );
+}
+
+void TargetManager::update_target_trace_bulk(TargetHandle handle, const TraceMeasurement* measurements, int count) {
+    bool found = update_target(handle, [&](Feature_Store& feature_store) {
+        feature_store.update_bulk(measurements, count);
+    });
+    if (!found) {
+        throw std::runtime_error("Stale target handle: slot " + std::to_string(handle.slot));
+    }
+}
+
+void TargetManager::compute_trace_features(const std::vector<int>& target_ids, std::vector<double>& features) {
+    std::lock_guard<std::mutex> query_lock(query_mutex);
+    query_engine.clear();
+    for (int target_id : target_ids) {
+        bool found = visit_target(target_id, [&](const Feature_Store& feature_store) {
+            query_engine.add(feature_store.get_trace_input(feature_store.get_smooth_window(), 0));
+        });
+        if (!found) {
+            throw std::runtime_error("Target ID not found: " + std::to_string(target_id));
+        }
+    }
+    features.resize(target_ids.size() * TRACE_FEATURE_DIM);
+    if (!target_ids.empty()) {
+        query_engine.compute(features.data());
+    }
 }
 
 void TargetManager::update_target_image(int target_id, const std::vector<unsigned char >& image_data) {
-    auto feature_store = get_feature_store(target_id);
-    if (!feature_store) {
+    update_target_image(target_id, std::make_shared<const std::vector<unsigned char>>(image_data));
+}
+
+bool TargetManager::update_target_image(TargetHandle handle, const std::vector<unsigned char >& image_data) {
+    return update_target_image(handle, std::make_shared<const std::vector<unsigned char>>(image_data));
+}
+
+void TargetManager::update_target_image(int target_id, ImageBuffer image_data) {
+    if (!image_data) {
+        throw std::runtime_error("Empty image buffer");
+    }
+    TargetShard& shard = shard_of(target_id);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    int slot = shard.target_slots.find(target_id);
+    if (slot == TargetIdMap::NOT_FOUND) {
         throw std::runtime_error("Target ID not found: " + std::to_string(target_id));
     }
-    
-    feature_store->update_image(image_data);
+    update_image_locked(shard, slot, std::move(image_data));
+}
+
+bool TargetManager::update_target_image(TargetHandle handle, ImageBuffer image_data) {
+    if (!image_data) {
+        throw std::runtime_error("Empty image buffer");
+    }
+    if (handle.shard < 0 || handle.shard >= static_cast<int>(shards.size())) {
+        return false;
+    }
+    TargetShard& shard = *shards[handle.shard];
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    if (!find_store_locked(shard, handle)) {
+        return false;
+    }
+    update_image_locked(shard, handle.slot, std::move(image_data));
+    return true;
 }
 
 bool TargetManager::is_target_track_initialized(int target_id) const {
-    auto it = target_stores.find(target_id);
-    if (it == target_stores.end()) {
+    const TargetShard& shard = shard_of(target_id);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    int slot = shard.target_slots.find(target_id);
+    if (slot == TargetIdMap::NOT_FOUND) {
         return false;
     }
-    return it->second->is_track_initialized();
+    return shard.slots[slot].store->is_track_initialized();
 }
 
 bool TargetManager::is_target_image_initialized(int target_id) const {
-    auto it = target_stores.find(target_id);
-    if (it == target_stores.end()) {
+    const TargetShard& shard = shard_of(target_id);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    int slot = shard.target_slots.find(target_id);
+    if (slot == TargetIdMap::NOT_FOUND) {
         return false;
     }
-    return it->second->is_image_initialized();
+    return shard.slots[slot].store->is_image_initialized();
 }
 
 bool TargetManager::is_target_fully_initialized(int target_id) const {
-    auto it = target_stores.find(target_id);
-    if (it == target_stores.end()) {
+    const TargetShard& shard = shard_of(target_id);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+    int slot = shard.target_slots.find(target_id);
+    if (slot == TargetIdMap::NOT_FOUND) {
         return false;
     }
-    return it->second->is_fully_initialized();
+    return shard.slots[slot].store->is_fully_initialized();
 }
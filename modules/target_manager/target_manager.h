@@ -1,36 +1,352 @@
 #ifndef TARGET_MANAGER_H
 #define TARGET_MANAGER_H
 
-#include <unordered_map>
+#include <atomic>
+#include <functional>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <vector> 
 #include "../feature_store/feature_store.h"
+#include "../feature_store/batch_feature_engine.h"
+#include "target_id_map.h"
+#include "feature_store_pool.h"
+#include "work_stealing_pool.h"
+#include "timing_wheel.h"
 
+/**
+ * 目标的稠密句柄：分片、分片内槽位下标加代数
+ * 目标移除后槽位的代数加一，旧句柄随之失效，不会误指向复用该槽位的新目标
+ */
+struct TargetHandle {
+    int slot = -1;
+    unsigned int generation = 0;
+    int shard = 0;
+
+    bool valid() const { return slot >= 0; }
+};
+
+// 目标被自动移除的原因
+enum EvictionReason {
+    EVICT_IDLE,       // 超过空闲时限没有更新
+    EVICT_CAPACITY    // 目标数超过上限，移除最久未更新的目标
+};
+
+// 图像内存统计
+struct ImageMemoryStats {
+    size_t image_bytes = 0;                 // 当前持有的原始图像字节数
+    size_t budget = 0;                      // 图像内存上限，0表示不限
+    int images = 0;                         // 持有原始图像的目标数
+    unsigned long long replaced = 0;        // 因超出上限以识别概率代替图像的次数
+    unsigned long long dropped = 0;         // 因超出上限丢弃图像的次数（尚未识别）
+};
+
+// 目标被自动移除后的回调，在分片锁之外调用，可以调用TargetManager的函数
+using EvictionCallback = std::function<void(int target_id, EvictionReason reason)>;
+
+/**
+ * 目标管理器
+ * 目标ID按散列分到若干分片，每个分片有独立的读写锁、槽位表与对象池
+ * 不同分片上的目标可以被多个线程并行更新，添加、移除目标只锁住所在分片
+ * 除get_feature_store外的公开函数都是线程安全的
+ */
 class TargetManager {
 private:
-    std::unordered_map<int, std::unique_ptr<Feature_Store>> target_stores;
+    // 一个目标槽位，store为空表示槽位空闲；对象本身由分片的store_pool持有
+    struct TargetSlot {
+        Feature_Store* store = nullptr;
+        int target_id = -1;
+        unsigned int generation = 0;
+        unsigned long long last_touch = 0;  // 最近一次更新时的时钟
+        int lru_prev = -1;                  // 分片内按最近更新排序的双向链表
+        int lru_next = -1;
+        size_t image_bytes = 0;             // 计入分片图像内存的字节数，0表示不在图像链表中
+        int image_prev = -1;                // 分片内按最近写入图像排序的双向链表
+        int image_next = -1;
+    };
+
+    // 一个分片，下列成员均由mutex保护
+    struct TargetShard {
+        mutable std::shared_mutex mutex;
+        std::vector<TargetSlot> slots;
+        std::vector<int> free_slots;
+        TargetIdMap target_slots;           // 目标ID -> 槽位
+        FeatureStorePool store_pool;        // 与slots下标一致的Feature_Store对象池
+        std::vector<double> feature_mean;   // 特征标准化参数，为空表示未设置
+        std::vector<double> feature_scale;
+
+        // 帧更新按目标切成的块，每块有自己的批量引擎与临时存储，不同的块可由不同线程同时处理
+        struct FrameChunk {
+            BatchFeatureEngine engine;
+            std::vector<Feature_Store*> stores;
+            std::vector<double> features;
+        };
+        std::vector<std::unique_ptr<FrameChunk>> frame_chunks;
+        AngleMode angle_mode = ANGLE_EXACT;  // 新建块的引擎使用的角度模式
+        TargetIdMap batch_last_index;       // 目标ID -> 帧内最后一次出现的量测下标
+        std::vector<int> frame_slots;
+        std::vector<int> frame_targets;     // 各目标在帧内最后一次出现的量测下标，按帧内顺序
+
+        // 空闲移除的时间轮（以槽位为条目）与最近更新链表，链表头为最近更新的目标
+        TimingWheel wheel;
+        int lru_head = -1;
+        int lru_tail = -1;
+
+        // 持有原始图像的目标链表，链表头为最近写入图像的目标
+        size_t image_bytes = 0;
+        int image_count = 0;
+        int image_head = -1;
+        int image_tail = -1;
+        unsigned long long images_replaced = 0;   // 以识别概率代替图像的次数
+        unsigned long long images_dropped = 0;    // 直接丢弃图像的次数
+
+        TargetShard(
+            double deltaT,
+            int based_window,
+            int cache_length,
+            int max_sequence_length,
+            int smooth_window,
+            bool lazy_sequence
+        );
+    };
+
+    std::vector<std::unique_ptr<TargetShard>> shards;
+    int shard_bits;                     // 分片数为 2^shard_bits
     double deltaT;
     int based_window;
     int cache_length;
+    int max_sequence_length;
+    int smooth_window;
+    bool lazy_sequence;
+
+    // compute_trace_features 使用的引擎，跨分片收集输入
+    std::mutex query_mutex;
+    BatchFeatureEngine query_engine;
+
+    // 并行帧更新的线程池，为空表示在调用线程中串行处理
+    std::unique_ptr<WorkStealingPool> worker_pool;
+
+    // 自动移除策略，0表示不启用
+    std::atomic<unsigned long long> clock;
+    unsigned long long idle_ttl = 0;
+    int shard_capacity = 0;
+    int max_targets = 0;
+    EvictionCallback eviction_callback;
+
+    // 图像内存上限，0表示不限；按分片平均分配
+    size_t image_budget = 0;
+    size_t shard_image_budget = 0;
+
+    int shard_index(int target_id) const {
+        if (shard_bits == 0) {
+            return 0;
+        }
+        // 取Fibonacci散列的最高位，与分片内TargetIdMap使用的位不重叠
+        return static_cast<int>(
+            (static_cast<unsigned long long>(static_cast<unsigned int>(target_id)) * 0x9E3779B97F4A7C15ULL) >> (64 - shard_bits)
+        );
+    }
+
+    TargetShard& shard_of(int target_id) const { return *shards[shard_index(target_id)]; }
+
+    // 以下函数要求调用方已持有分片的锁
+    TargetHandle add_target_locked(TargetShard& shard, int shard_id, int target_id);
+    Feature_Store* find_store_locked(const TargetShard& shard, TargetHandle handle) const;
+    void touch_locked(TargetShard& shard, int slot);            // 记录一次更新：刷新时间并移到链表头
+    void release_slot_locked(TargetShard& shard, int slot);     // 移除槽位上的目标
+    void lru_unlink_locked(TargetShard& shard, int slot);
+    // 目标数超过分片上限时移除最久未更新的目标，ID追加到evicted
+    void enforce_capacity_locked(TargetShard& shard, std::vector<int>& evicted);
+    // 写入图像并更新图像内存统计，超出分片预算时释放最久未写入的图像
+    void update_image_locked(TargetShard& shard, int slot, ImageBuffer image_data);
+    void image_unlink_locked(TargetShard& shard, int slot);
+    void release_image_locked(TargetShard& shard, int slot);   // 释放槽位上目标的原始图像
+    void enforce_image_budget_locked(TargetShard& shard, int keep_slot);
+
+    // 在分片锁之外通知被移除的目标
+    void notify_evicted(const std::vector<int>& target_ids, EvictionReason reason);
+
+    template <typename Visitor>
+    bool access_target(int target_id, Visitor& visit, bool touch) {
+        TargetShard& shard = shard_of(target_id);
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        int slot = shard.target_slots.find(target_id);
+        if (slot == TargetIdMap::NOT_FOUND) {
+            return false;
+        }
+        if (touch) {
+            touch_locked(shard, slot);
+        }
+        visit(*shard.slots[slot].store);
+        return true;
+    }
+
+    template <typename Visitor>
+    bool access_target(TargetHandle handle, Visitor& visit, bool touch) {
+        if (handle.shard < 0 || handle.shard >= static_cast<int>(shards.size())) {
+            return false;
+        }
+        TargetShard& shard = *shards[handle.shard];
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        Feature_Store* feature_store = find_store_locked(shard, handle);
+        if (!feature_store) {
+            return false;
+        }
+        if (touch) {
+            touch_locked(shard, handle.slot);
+        }
+        visit(*feature_store);
+        return true;
+    }
+
+    template <typename Visitor>
+    bool read_target(int target_id, Visitor& visit) const {
+        const TargetShard& shard = shard_of(target_id);
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        int slot = shard.target_slots.find(target_id);
+        if (slot == TargetIdMap::NOT_FOUND) {
+            return false;
+        }
+        visit(static_cast<const Feature_Store&>(*shard.slots[slot].store));
+        return true;
+    }
+
+    template <typename Visitor>
+    bool read_target(TargetHandle handle, Visitor& visit) const {
+        if (handle.shard < 0 || handle.shard >= static_cast<int>(shards.size())) {
+            return false;
+        }
+        const TargetShard& shard = *shards[handle.shard];
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        const Feature_Store* feature_store = find_store_locked(shard, handle);
+        if (!feature_store) {
+            return false;
+        }
+        visit(*feature_store);
+        return true;
+    }
+
+    // 帧更新中一个块包含的目标数
+    static constexpr int FRAME_CHUNK_TARGETS = 256;
+
+    // 加锁处理一帧中属于同一分片的量测，indices为这些量测在帧内的下标，按帧内顺序排列
+    void update_shard_frame(int shard_id, const std::vector<TraceMeasurement>& frame,
+                            const int* indices, int count, bool add_missing);
+    // 以下三步依次为：解析（可能抛出异常，不修改已有目标）、完成帧内重复的量测并分块、处理一个块
+    void resolve_shard_frame_locked(TargetShard& shard, int shard_id, const std::vector<TraceMeasurement>& frame,
+                                    const int* indices, int count, bool add_missing);
+    int prepare_frame_chunks_locked(TargetShard& shard, const std::vector<TraceMeasurement>& frame,
+                                    const int* indices, int count);
+    // 只访问块内目标与块自己的临时存储，同一分片的不同块可以并发执行
+    void update_frame_chunk(TargetShard& shard, const std::vector<TraceMeasurement>& frame,
+                            const int* indices, int chunk);
     
 public:
     TargetManager(
         double deltaT,
         int based_window,
         int cache_length,
-        int max_sequence_length
+        int max_sequence_length = 10,
+        int smooth_window = 5,
+        bool lazy_sequence = false,  // 目标的序列特征是否在查询时才计算
+        int num_shards = 1           // 分片数，向上取整为2的幂
     );
+
+    // 分片数
+    int shard_count() const { return static_cast<int>(shards.size()); }
+
+    // 序列特征是否在查询时才计算，此时读取序列需要modify_target
+    bool is_lazy_sequence() const { return lazy_sequence; }
+
+    // 目标所在的分片，[0, shard_count())
+    int target_shard(int target_id) const { return shard_index(target_id); }
     
-    // 添加新目标
-    void add_target(int target_id);
+    /**
+     * 添加新目标，目标已存在时直接返回其句柄
+     * @return 稳定的目标句柄，在目标移除前一直有效
+     */
+    TargetHandle add_target(int target_id);
+
+    /**
+     * 查找目标句柄，不存在时返回无效句柄
+     */
+    TargetHandle find_target(int target_id) const;
+
+    /**
+     * 通过句柄直接访问目标，不做哈希查找；句柄已失效时返回nullptr
+     * 不加锁，多线程下应使用visit_target或modify_target
+     */
+    Feature_Store* get_feature_store(TargetHandle handle) {
+        if (handle.shard < 0 || handle.shard >= static_cast<int>(shards.size())) {
+            return nullptr;
+        }
+        return find_store_locked(*shards[handle.shard], handle);
+    }
+
+    /**
+     * 持有目标所在分片的读锁只读访问目标，visit(const Feature_Store&)，同一分片上的读者可以并发
+     * visit应尽快返回，耗时的计算应先复制所需数据，在锁外进行
+     * @return 目标不存在或句柄已失效时返回false，visit不会被调用
+     */
+    template <typename Visitor>
+    bool visit_target(int target_id, Visitor visit) const { return read_target(target_id, visit); }
+
+    template <typename Visitor>
+    bool visit_target(TargetHandle handle, Visitor visit) const { return read_target(handle, visit); }
+
+    /**
+     * 持有目标所在分片的写锁访问目标，visit(Feature_Store&)，不计为目标的更新
+     * 用于写入识别结果、惰性模式下计算序列特征等需要修改对象的访问
+     */
+    template <typename Visitor>
+    bool modify_target(int target_id, Visitor visit) { return access_target(target_id, visit, false); }
+
+    template <typename Visitor>
+    bool modify_target(TargetHandle handle, Visitor visit) { return access_target(handle, visit, false); }
+
+    /**
+     * 与modify_target相同（持有写锁，visit(Feature_Store&)可修改目标），但计为目标的一次更新，
+     * 刷新空闲时限与最近更新顺序
+     */
+    template <typename Visitor>
+    bool update_target(int target_id, Visitor visit) { return access_target(target_id, visit, true); }
+
+    template <typename Visitor>
+    bool update_target(TargetHandle handle, Visitor visit) { return access_target(handle, visit, true); }
+
+    /**
+     * 设置自动移除策略，应在开始写入前调用
+     * @param idle_ttl 空闲时限（时钟单位），目标超过该时长没有更新时在tick中移除，0表示不限
+     * @param max_targets 目标数上限，添加目标后超过上限时移除最久未更新的目标，0表示不限
+     *        上限按分片平均分配，每个分片最多 ceil(max_targets / shard_count()) 个目标
+     * @param callback 目标被自动移除后的回调，可以为空
+     */
+    void set_eviction_policy(int idle_ttl, int max_targets, EvictionCallback callback = nullptr);
+
+    /**
+     * 时钟前进ticks个单位并移除空闲超时的目标，通常每帧调用一次
+     * 时间轮每个时钟单位只检查到期的桶，开销与目标总数无关
+     * @return 本次移除的目标数
+     */
+    int tick(unsigned long long ticks = 1);
+
+    // 当前时钟
+    unsigned long long current_tick() const { return clock.load(std::memory_order_relaxed); }
+
+    /**
+     * 设置序列特征的标准化参数，作用于已有目标和之后添加的目标
+     * @throws std::runtime_error 如果参数长度不是TRACE_FEATURE_DIM
+     */
+    void set_feature_normalization(const std::vector<double>& mean, const std::vector<double>& scale);
     
     // 移除目标
     void remove_target(int target_id);
+    void remove_target(TargetHandle handle);
     
     // 检查目标是否存在
     bool has_target(int target_id) const;
     
-    // 获取特定目标的Feature Store
+    // 获取特定目标的Feature Store，不加锁，多线程下应使用visit_target或modify_target
     Feature_Store* get_feature_store(int target_id);
     
     // 更新目标航迹数据
@@ -41,9 +357,79 @@ public:
         double filter_v_x, double filter_v_y, double filter_v_z,
         double filter_a_x, double filter_a_y, double filter_a_z
     );
+    void update_target_trace(
+        TargetHandle handle,
+        double obs_x, double obs_y, double obs_z,
+        double filter_p_x, double filter_p_y, double filter_p_z,
+        double filter_v_x, double filter_v_y, double filter_v_z,
+        double filter_a_x, double filter_a_y, double filter_a_z
+    );
+    
+    /**
+     * 以一次向量化批量计算处理一帧内多个目标的航迹更新
+     * 各目标的结果与逐个调用update_target_trace一致
+     * 同一目标在帧内出现多次时按顺序处理，前面的量测走逐个更新
+     * 每个量测只查找一次目标，处理当前目标时预取下一个目标的状态
+     * 量测按分片分组，串行时逐个分片加锁处理，同一时刻只持有一个分片的锁
+     * 开启并行更新时按分片号升序持有帧内全部分片的写锁，各分片的目标按FRAME_CHUNK_TARGETS个一块
+     * 作为任务交给工作窃取线程池并发处理，单个分片也能并行
+     * @param add_missing 为true时自动添加帧内不存在的目标，否则整帧拒绝
+     *        （其他线程在处理过程中移除帧内目标时，已处理的分片不回滚）
+     */
+    void update_targets_trace(const std::vector<TraceMeasurement>& frame, bool add_missing = false);
+
+    /**
+     * 设置帧更新的并行线程数（含调用线程），不大于1时关闭并行
+     * 并行度以目标块为单位，帧内目标数应为FRAME_CHUNK_TARGETS的数倍；应在开始写入前调用
+     */
+    void set_parallel_workers(int threads);
+    int parallel_workers() const { return worker_pool ? worker_pool->thread_count() : 1; }
+
+    /**
+     * 单个目标的连续量测批量写入（回填/回放），只查找一次目标
+     * 各量测的target_id不参与查找
+     */
+    void update_target_trace_bulk(int target_id, const TraceMeasurement* measurements, int count);
+    void update_target_trace_bulk(TargetHandle handle, const TraceMeasurement* measurements, int count);
+
+    /**
+     * 批量计算多个目标最新时刻的37维航迹特征
+     * @param features 输出 [target_ids.size(), TRACE_FEATURE_DIM]，行优先
+     */
+    void compute_trace_features(const std::vector<int>& target_ids, std::vector<double>& features);
+
+    // 批量路径中方位角、仰角的计算方式，默认与逐个更新逐位一致
+    void set_angle_mode(AngleMode mode);
     
-    // 更新目标图像数据
+    /**
+     * 更新目标图像数据，计为目标的一次更新
+     * 设置了图像内存上限时，超出上限后按最近写入顺序释放其他目标的原始图像：
+     * 已缓存识别概率的目标以概率代替图像，其余目标回到图像未初始化状态
+     * const引用版本在加锁前复制图像；ImageBuffer版本与调用方共享图像，不复制
+     * ID版本在目标不存在时抛出异常；句柄版本与update_target一致，句柄已失效时返回false
+     */
     void update_target_image(int target_id, const std::vector<unsigned char>& image_data);
+    bool update_target_image(TargetHandle handle, const std::vector<unsigned char>& image_data);
+    void update_target_image(int target_id, ImageBuffer image_data);
+    bool update_target_image(TargetHandle handle, ImageBuffer image_data);
+
+    /**
+     * 设置全部目标原始图像的内存上限（字节），0表示不限
+     * 上限按分片平均分配；刚写入的图像总是保留，即使单张图像超出分片上限
+     */
+    void set_image_budget(size_t bytes);
+
+    // 图像内存统计，各分片之和
+    ImageMemoryStats image_memory_stats() const;
+
+    // 单个目标占用的内存字节数，目标不存在时返回0
+    size_t target_memory_bytes(int target_id) const;
+
+    // 全部目标占用的内存字节数，含对象池中空闲的对象
+    size_t total_memory_bytes() const;
+
+    // 当前目标数
+    int target_count() const;
     
     // 添加检查目标初始化状态的函数
     bool is_target_track_initialized(int target_id) const;
@@ -0,0 +1,67 @@
+#include "timing_wheel.h"
+
+TimingWheel::TimingWheel() : heads(LEVELS * SLOTS, -1) {
+}
+
+void TimingWheel::link(int id, int bucket) {
+    Node& node = nodes[id];
+    node.bucket = bucket;
+    node.prev = -1;
+    node.next = heads[bucket];
+    if (node.next >= 0) {
+        nodes[node.next].prev = id;
+    }
+    heads[bucket] = id;
+}
+
+void TimingWheel::unlink(int id) {
+    Node& node = nodes[id];
+    if (node.prev >= 0) {
+        nodes[node.prev].next = node.next;
+    } else {
+        heads[node.bucket] = node.next;
+    }
+    if (node.next >= 0) {
+        nodes[node.next].prev = node.prev;
+    }
+    node.prev = -1;
+    node.next = -1;
+    node.bucket = -1;
+}
+
+void TimingWheel::place(int id) {
+    unsigned long long deadline = nodes[id].deadline > current ? nodes[id].deadline : current;
+    unsigned long long delta = deadline - current;
+    for (int level = 0; level < LEVELS; ++level) {
+        if (delta < (1ULL << (SLOT_BITS * (level + 1)))) {
+            link(id, level * SLOTS + static_cast<int>((deadline >> (SLOT_BITS * level)) & (SLOTS - 1)));
+            return;
+        }
+    }
+    // 超出最高层范围：放在最高层最远的桶，迁移时再按实际到期时间放置
+    int top = LEVELS - 1;
+    unsigned long long farthest = current + (1ULL << (SLOT_BITS * LEVELS)) - 1;
+    link(id, top * SLOTS + static_cast<int>((farthest >> (SLOT_BITS * top)) & (SLOTS - 1)));
+}
+
+void TimingWheel::schedule(int id, unsigned long long deadline) {
+    if (id >= static_cast<int>(nodes.size())) {
+        nodes.resize(id + 1);
+    }
+    if (nodes[id].bucket >= 0) {
+        unlink(id);
+    } else {
+        ++count;
+    }
+    // 当前时刻的桶已处理过，最早在下一时刻到期
+    nodes[id].deadline = deadline > current ? deadline : current + 1;
+    place(id);
+}
+
+void TimingWheel::cancel(int id) {
+    if (!is_scheduled(id)) {
+        return;
+    }
+    unlink(id);
+    --count;
+}
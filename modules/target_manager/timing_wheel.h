@@ -0,0 +1,91 @@
+#ifndef TIMING_WHEEL_H
+#define TIMING_WHEEL_H
+
+#include <vector>
+
+/**
+ * 分层时间轮
+ * LEVELS 层，每层 SLOTS 个桶，第L层一个桶覆盖 SLOTS^L 个时钟单位
+ * 条目以非负整数编号，保存在侵入式双向链表中，定时、取消均为O(1)
+ * 时钟每前进一个单位只处理第0层的一个桶，第L层的桶每 SLOTS^L 个单位向下层迁移一次
+ */
+class TimingWheel {
+public:
+    static constexpr int SLOT_BITS = 6;
+    static constexpr int SLOTS = 1 << SLOT_BITS;
+    static constexpr int LEVELS = 4;
+
+private:
+    struct Node {
+        int prev = -1;
+        int next = -1;
+        int bucket = -1;                  // -1 表示未定时
+        unsigned long long deadline = 0;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<int> heads;               // LEVELS * SLOTS 个桶的链表头
+    unsigned long long current = 0;
+    int count = 0;
+
+    void link(int id, int bucket);
+    void unlink(int id);
+    // 按到期时间放入对应的桶，到期时间早于当前时间时视为当前时间
+    void place(int id);
+
+public:
+    TimingWheel();
+
+    /**
+     * 设定条目的到期时间，已定时的条目改为新的到期时间
+     * 到期时间不晚于当前时间时在下一次前进时到期
+     */
+    void schedule(int id, unsigned long long deadline);
+
+    // 取消定时，未定时的条目忽略
+    void cancel(int id);
+
+    bool is_scheduled(int id) const {
+        return id >= 0 && id < static_cast<int>(nodes.size()) && nodes[id].bucket >= 0;
+    }
+
+    unsigned long long time() const { return current; }
+    int size() const { return count; }
+
+    /**
+     * 时钟前进到now，对到期时间不晚于now的条目调用expire(id)
+     * 调用前条目已取消定时，expire中可以重新定时或取消其他条目
+     */
+    template <typename Expire>
+    void advance(unsigned long long now, Expire expire) {
+        while (current < now) {
+            ++current;
+            // 由高到低迁移：高层桶中的条目可能落入本时刻将要迁移或处理的低层桶
+            for (int level = LEVELS - 1; level >= 1; --level) {
+                unsigned long long span_mask = (1ULL << (SLOT_BITS * level)) - 1;
+                if ((current & span_mask) != 0) {
+                    continue;
+                }
+                int bucket = level * SLOTS + static_cast<int>((current >> (SLOT_BITS * level)) & (SLOTS - 1));
+                while (heads[bucket] >= 0) {
+                    int id = heads[bucket];
+                    unlink(id);
+                    place(id);
+                }
+            }
+            int bucket = static_cast<int>(current & (SLOTS - 1));
+            while (heads[bucket] >= 0) {
+                int id = heads[bucket];
+                unlink(id);
+                if (nodes[id].deadline <= current) {
+                    --count;
+                    expire(id);
+                } else {
+                    place(id);   // 超出最高层范围的条目
+                }
+            }
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,129 @@
+#include "work_stealing_pool.h"
+#include <stdexcept>
+#include <string>
+
+WorkStealingPool::WorkStealingPool(int threads) : remaining(0) {
+    if (threads < 1) {
+        throw std::runtime_error("Invalid thread count: " + std::to_string(threads));
+    }
+    for (int i = 0; i < threads; ++i) {
+        queues.push_back(std::make_unique<TaskQueue>());
+    }
+    for (int i = 1; i < threads; ++i) {
+        workers.emplace_back([this, i]() { worker_loop(i); });
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+bool WorkStealingPool::pop_local(int self, int& task) {
+    TaskQueue& queue = *queues[self];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) {
+        return false;
+    }
+    task = queue.tasks.back();
+    queue.tasks.pop_back();
+    return true;
+}
+
+bool WorkStealingPool::steal(int self, int& task) {
+    int count = thread_count();
+    for (int offset = 1; offset < count; ++offset) {
+        TaskQueue& victim = *queues[(self + offset) % count];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::execute(int self) {
+    int task;
+    while (pop_local(self, task) || steal(self, task)) {
+        try {
+            (*current_task)(task);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(state_mutex);
+            if (!first_error) {
+                first_error = std::current_exception();
+            }
+        }
+        if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            std::lock_guard<std::mutex> lock(state_mutex);
+            done.notify_all();
+        }
+    }
+}
+
+void WorkStealingPool::worker_loop(int self) {
+    unsigned long long seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(state_mutex);
+            wake.wait(lock, [&]() { return stopping || epoch != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = epoch;
+        }
+        execute(self);
+    }
+}
+
+void WorkStealingPool::run(int count, const std::function<void(int)>& task) {
+    if (count <= 0) {
+        return;
+    }
+    std::lock_guard<std::mutex> run_lock(run_mutex);
+    int threads = thread_count();
+    if (threads == 1 || count == 1) {
+        for (int i = 0; i < count; ++i) {
+            task(i);
+        }
+        return;
+    }
+
+    // 任务在放入队列之前就位，窃取到任务的线程一定能看到本次的task
+    current_task = &task;
+    first_error = nullptr;
+    remaining.store(count, std::memory_order_release);
+    for (int q = 0; q < threads; ++q) {
+        int begin = static_cast<int>(static_cast<long long>(count) * q / threads);
+        int end = static_cast<int>(static_cast<long long>(count) * (q + 1) / threads);
+        TaskQueue& queue = *queues[q];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        for (int i = begin; i < end; ++i) {
+            queue.tasks.push_back(i);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(state_mutex);
+        ++epoch;
+    }
+    wake.notify_all();
+
+    execute(0);
+    std::exception_ptr error;
+    {
+        std::unique_lock<std::mutex> lock(state_mutex);
+        done.wait(lock, [&]() { return remaining.load(std::memory_order_acquire) == 0; });
+        error = first_error;
+        first_error = nullptr;
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * 工作窃取线程池
+ * 每个线程有自己的任务队列，run开始时任务按连续区间分给各队列；
+ * 线程先从自己队列的尾部取任务，取空后从其他队列的头部窃取，负载不均时自动平衡
+ * 调用run的线程也参与执行，thread_count个线程中有thread_count-1个后台线程
+ * 同一时刻只执行一次run，多个线程同时调用时依次执行
+ */
+class WorkStealingPool {
+private:
+    struct TaskQueue {
+        std::mutex mutex;
+        std::deque<int> tasks;
+    };
+
+    std::vector<std::unique_ptr<TaskQueue>> queues;   // queues[0] 属于调用run的线程
+    std::vector<std::thread> workers;
+
+    std::mutex run_mutex;                // 串行化run
+    std::mutex state_mutex;              // 保护下列状态与两个条件变量
+    std::condition_variable wake;
+    std::condition_variable done;
+    unsigned long long epoch = 0;        // 每次run加一，唤醒后台线程
+    bool stopping = false;
+    const std::function<void(int)>* current_task = nullptr;
+    std::atomic<int> remaining;
+    std::exception_ptr first_error;
+
+    bool pop_local(int self, int& task);
+    bool steal(int self, int& task);
+    void execute(int self);
+    void worker_loop(int self);
+
+public:
+    // threads 为参与计算的线程总数（含调用线程），至少为1
+    explicit WorkStealingPool(int threads);
+    ~WorkStealingPool();
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    int thread_count() const { return static_cast<int>(queues.size()); }
+
+    /**
+     * 并行执行 task(i)，i ∈ [0, count)，全部完成后返回
+     * 任务抛出异常时其余任务照常执行，run返回前重新抛出第一个异常
+     */
+    void run(int count, const std::function<void(int)>& task);
+};
+
+#endif
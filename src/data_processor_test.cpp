@@ -7,6 +7,7 @@
 #include <xtensor/xadapt.hpp>
 #include <xtensor/xview.hpp>
 #include "../modules/preprocessor/data_preprocessor.h"
+#include "../modules/preprocessor/image_kernels.h"
 
 // 简单的测试辅助宏
 #define TEST_ASSERT(condition, message) \
@@ -94,6 +95,199 @@ public:
         return true;
     }
 
+    // 测试裁剪区域缩放：与整幅缩放后再裁剪逐位一致，尺寸不变时只做通道调整和除以255
+    bool test_resize_crop_kernel() {
+        std::cout << "Running test: Resize crop kernel..." << std::endl;
+        
+        const int src_h = 37, src_w = 53;
+        std::vector<unsigned char > src(src_h * src_w * 3);
+        for (size_t i = 0; i < src.size(); ++i) {
+            src[i] = static_cast<unsigned char>((i * 7919 + 13) % 256);
+        }
+        
+        for (int out_h : {11, 37, 60}) {
+            int out_w = out_h + 5;
+            std::vector<float> full(out_h * out_w * 3);
+            resize_crop_u8(src.data(), src_h, src_w, src_w * 3, false, out_h, out_w, 0, 0, out_h, out_w, full.data());
+            int top = out_h / 3, left = out_w / 4, crop_h = out_h / 2, crop_w = out_w / 2;
+            std::vector<float> crop(crop_h * crop_w * 3);
+            resize_crop_u8(src.data(), src_h, src_w, src_w * 3, false, out_h, out_w, top, left, crop_h, crop_w, crop.data());
+            for (int y = 0; y < crop_h; ++y) {
+                for (int x = 0; x < crop_w * 3; ++x) {
+                    TEST_ASSERT(crop[y * crop_w * 3 + x] == full[(y + top) * out_w * 3 + left * 3 + x],
+                                "Cropped resize should match full resize");
+                }
+            }
+        }
+        
+        // AVX2路径与标量路径逐位一致（不支持AVX2时两者相同）
+        for (int out_w : {7, 24, 53, 90}) {
+            std::vector<float> simd(20 * out_w * 3);
+            std::vector<float> scalar(20 * out_w * 3);
+            resize_crop_u8(src.data(), src_h, src_w, src_w * 3, true, 20, out_w, 0, 0, 20, out_w, simd.data());
+            resize_crop_u8(src.data(), src_h, src_w, src_w * 3, true, 20, out_w, 0, 0, 20, out_w, scalar.data(), false);
+            TEST_ASSERT(simd == scalar, std::string("SIMD path should match scalar path: ") + image_kernel_simd_path());
+        }
+        
+        std::vector<float> same(src_h * src_w * 3);
+        resize_crop_u8(src.data(), src_h, src_w, src_w * 3, true, src_h, src_w, 0, 0, src_h, src_w, same.data());
+        for (int i = 0; i < src_h * src_w; ++i) {
+            for (int c = 0; c < 3; ++c) {
+                TEST_ASSERT(same[i * 3 + c] == static_cast<float>(src[i * 3 + 2 - c]) / 255.0f, "Identity resize should only swap channels");
+            }
+        }
+        
+        bool threw = false;
+        try {
+            resize_crop_u8(src.data(), src_h, src_w, src_w * 3, false, 20, 20, 0, 0, 21, 20, same.data());
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        TEST_ASSERT(threw, "Crop larger than the resized image should be rejected");
+        
+        std::cout << "Test passed!" << std::endl;
+        return true;
+    }
+
+    // 测试标准化内核：SIMD与标量一致，CHW与HWC布局一致，与逐步计算的结果一致
+    bool test_normalize_kernel() {
+        std::cout << "Running test: Normalize kernel..." << std::endl;
+        
+        const float mean[3] = {0.485f, 0.456f, 0.406f};
+        const float std_dev[3] = {0.229f, 0.224f, 0.225f};
+        NormalizeParams byte_params = make_normalize_params(mean, std_dev, 255.0f);
+        NormalizeParams unit_params = make_normalize_params(mean, std_dev, 1.0f);
+        
+        const int h = 5;
+        for (int w : {3, 8, 19}) {
+            const int step = w * 3 + 4;
+            std::vector<unsigned char > src(h * step);
+            for (size_t i = 0; i < src.size(); ++i) {
+                src[i] = static_cast<unsigned char>((i * 7919 + 13) % 256);
+            }
+            std::vector<float> unit(h * w * 3);
+            for (int y = 0; y < h; ++y) {
+                for (int i = 0; i < w * 3; ++i) {
+                    unit[y * w * 3 + i] = src[y * step + i] / 255.0f;
+                }
+            }
+            
+            std::vector<float> chw(h * w * 3), hwc(h * w * 3), scalar(h * w * 3), from_float(h * w * 3);
+            normalize_hwc_u8(src.data(), h, w, step, true, byte_params, NORMALIZE_CHW, chw.data());
+            normalize_hwc_u8(src.data(), h, w, step, true, byte_params, NORMALIZE_CHW, scalar.data(), false);
+            TEST_ASSERT(chw == scalar, std::string("SIMD normalize should match scalar path: ") + image_kernel_simd_path());
+            normalize_hwc_u8(src.data(), h, w, step, true, byte_params, NORMALIZE_HWC, hwc.data());
+            normalize_hwc_f32(unit.data(), h, w, unit_params, NORMALIZE_HWC, from_float.data());
+            
+            for (int y = 0; y < h; ++y) {
+                for (int x = 0; x < w; ++x) {
+                    for (int c = 0; c < 3; ++c) {
+                        float expected = (src[y * step + x * 3 + 2 - c] / 255.0f - mean[c]) / std_dev[c];
+                        float value = chw[(c * h + y) * w + x];
+                        TEST_ASSERT(std::abs(value - expected) < 1e-5, "Normalized value mismatch");
+                        TEST_ASSERT(hwc[(y * w + x) * 3 + c] == value, "HWC layout should hold the same values");
+                        float unswapped = (unit[y * w * 3 + x * 3 + c] - mean[c]) / std_dev[c];
+                        TEST_ASSERT(std::abs(from_float[(y * w + x) * 3 + c] - unswapped) < 1e-5, "Float input mismatch");
+                    }
+                }
+            }
+        }
+        
+        std::cout << "Test passed!" << std::endl;
+        return true;
+    }
+
+    // 测试直接写入批量张量的一个样本
+    bool test_image_preprocess_into_batch() {
+        std::cout << "Running test: Image preprocess into batch..." << std::endl;
+        
+        try {
+            std::vector<unsigned char > image_data = read_binary_file(image_path_);
+            ImagePreprocessor preprocessor(256, 224);
+            torch::Tensor single = preprocessor.preprocess(image_data);
+            
+            torch::Tensor batch = torch::zeros({2, 3, 224, 224}, torch::kFloat32);
+            preprocessor.preprocess_into(image_data.data(), image_data.size(), batch[1].data_ptr<float>());
+            TEST_ASSERT(preprocessor.output_size() == static_cast<size_t>(batch[1].numel()), "Wrong output size");
+            TEST_ASSERT(torch::equal(batch[1], single[0]), "Batch slot should match single preprocess");
+            TEST_ASSERT(batch[0].abs().max().item<float>() == 0.0f, "Other batch slots should be untouched");
+        } catch (const std::exception& e) {
+            std::cerr << "Exception occurred: " << e.what() << std::endl;
+            return false;
+        }
+        
+        std::cout << "Test passed!" << std::endl;
+        return true;
+    }
+
+    // 测试JPEG缩小解码：按短边选择倍数，结果在记录的误差范围内
+    bool test_scaled_decode() {
+        std::cout << "Running test: Scaled JPEG decode..." << std::endl;
+        
+        try {
+            ImagePreprocessor preprocessor(256, 224);
+            TEST_ASSERT(preprocessor.decode_reduction(2160, 3840) == 1, "Scaled decode should be off by default");
+            preprocessor.set_scaled_decode(true);
+            TEST_ASSERT(preprocessor.decode_reduction(2160, 3840) == 8, "4K short side should allow 8x reduction");
+            TEST_ASSERT(preprocessor.decode_reduction(1280, 1920) == 4, "Wrong reduction for 1280 short side");
+            TEST_ASSERT(preprocessor.decode_reduction(1000, 600) == 2, "Wrong reduction for 600 short side");
+            TEST_ASSERT(preprocessor.decode_reduction(300, 400) == 1, "Small images should be decoded at full size");
+            
+            std::vector<unsigned char > image_data = read_binary_file(image_path_);
+            ImagePreprocessor full(256, 224);
+            torch::Tensor expected = full.preprocess(image_data);
+            PreprocessReport report;
+            torch::Tensor reduced = preprocessor.preprocess_with_report(image_data.data(), image_data.size(), report);
+            TEST_ASSERT(reduced.sizes() == expected.sizes(), "Scaled decode should not change the output shape");
+            TEST_ASSERT(report.decode_reduction > 1, "Sample image should be decoded at reduced size");
+            TEST_ASSERT(report.image_height == 1280 && report.image_width == 1920, "Report should keep the original size");
+            float max_diff = (reduced - expected).abs().max().item<float>();
+            float mean_diff = (reduced - expected).abs().mean().item<float>();
+            std::cout << "Scaled decode max diff: " << max_diff << ", mean diff: " << mean_diff << std::endl;
+            TEST_ASSERT(max_diff < 0.5f && mean_diff < 0.05f, "Scaled decode error exceeds the documented tolerance");
+        } catch (const std::exception& e) {
+            std::cerr << "Exception occurred: " << e.what() << std::endl;
+            return false;
+        }
+        
+        std::cout << "Test passed!" << std::endl;
+        return true;
+    }
+
+    // 测试诊断模式：输出与生产模式一致，统计记录在报告中
+    bool test_image_preprocess_diagnostics() {
+        std::cout << "Running test: Image preprocess diagnostics..." << std::endl;
+        
+        try {
+            std::vector<unsigned char > image_data = read_binary_file(image_path_);
+            ImagePreprocessor production(256, 224);
+            ImagePreprocessor diagnostic(256, 224, PREPROCESS_DIAGNOSTIC);
+            
+            torch::Tensor fast = production.preprocess(image_data);
+            TEST_ASSERT(production.last_report().stages.empty(), "Production mode should not record statistics");
+            
+            torch::Tensor checked = diagnostic.preprocess(image_data);
+            TEST_ASSERT(torch::equal(fast, checked), "Diagnostic mode should not change the output");
+            
+            PreprocessReport report = diagnostic.last_report();
+            TEST_ASSERT(report.stages.size() == 3, "Report should cover every stage");
+            TEST_ASSERT(report.stages[0].stage == "decode" && report.stages[2].stage == "normalize", "Wrong stage order");
+            TEST_ASSERT(report.channels.size() == 3, "Report should have per-channel statistics");
+            TEST_ASSERT(report.stages[2].shape == std::vector<int64_t>({1, 3, 224, 224}), "Wrong normalized shape");
+            TEST_ASSERT(std::abs(report.stages[2].max - fast.max().item<float>()) < 1e-6, "Wrong stage maximum");
+            
+            PreprocessReport explicit_report;
+            production.preprocess_with_report(image_data.data(), image_data.size(), explicit_report);
+            TEST_ASSERT(explicit_report.stages.size() == 3, "Explicit report should be recorded in production mode");
+        } catch (const std::exception& e) {
+            std::cerr << "Exception occurred: " << e.what() << std::endl;
+            return false;
+        }
+        
+        std::cout << "Test passed!" << std::endl;
+        return true;
+    }
+
     // 测试特征预处理器初始化
     bool test_trace_preprocessor_initialization() {
         std::cout << "Running test: Trace preprocessor initialization..." << std::endl;
@@ -317,6 +511,11 @@ public:
         bool all_passed = true;
         all_passed &= test_image_preprocessor_initialization();
         all_passed &= test_image_preprocessing_pipeline();
+        all_passed &= test_resize_crop_kernel();
+        all_passed &= test_normalize_kernel();
+        all_passed &= test_image_preprocess_into_batch();
+        all_passed &= test_scaled_decode();
+        all_passed &= test_image_preprocess_diagnostics();
         all_passed &= test_trace_preprocessor_initialization();
         all_passed &= test_trace_preprocessing_pipeline();
         all_passed &= test_error_handling();
@@ -3,8 +3,11 @@
 #include <stdexcept>
 #include <cassert>
 #include "../modules/feature_store/feature_store.h"
+#include "../modules/feature_store/batch_feature_engine.h"
+#include "../modules/feature_store/angle_math.h"
 #include <fstream>
 #include <cmath>
+#include <algorithm>
 
 // Test assertion macro
 #define TEST_ASSERT(condition, message) \
@@ -103,6 +106,16 @@ bool test_feature_store_image_handling() {
     TEST_ASSERT(retrieved_data.size() == image_data.size(), "Retrieved image data size should match original");
     TEST_ASSERT(retrieved_data == image_data, "Retrieved image data should match original");
     
+    // 共享缓冲区不复制，右值版本接管原数据
+    ImageBuffer shared = std::make_shared<const std::vector<unsigned char>>(image_data);
+    store.update_image(shared);
+    TEST_ASSERT(store.get_image_buffer().get() == shared.get(), "Shared image buffer should not be copied");
+    std::vector<unsigned char> owned = image_data;
+    const unsigned char* owned_bytes = owned.data();
+    store.update_image(std::move(owned));
+    TEST_ASSERT(store.get_image_data().data() == owned_bytes, "Moved image data should not be copied");
+    TEST_ASSERT(shared.use_count() == 1, "Replaced image buffer should be released");
+    
     std::cout << "Image handling test passed!" << std::endl;
     return true;
 }
@@ -126,17 +139,465 @@ bool test_feature_store_vector_operations() {
     TEST_ASSERT(std::abs(mag - std::sqrt(14.0)) < EPSILON, "Vector magnitude calculation failed");
     
     // Test vector addition
-    xt::xarray<double> sum = store.Add(vec1, vec2);
+    Vec3 sum = store.Add(vec1, vec2);
     TEST_ASSERT(sum[0] == 5.0 && sum[1] == 7.0 && sum[2] == 9.0, "Vector addition failed");
     
     // Test vector subtraction
-    xt::xarray<double> diff = store.Sub(vec2, vec1);
+    Vec3 diff = store.Sub(vec2, vec1);
     TEST_ASSERT(diff[0] == 3.0 && diff[1] == 3.0 && diff[2] == 3.0, "Vector subtraction failed");
     
+    // Views over the cache share storage with it instead of copying
+    BatchVector history(3);
+    history.update(1.0, 2.0, 3.0);
+    history.update(4.0, 5.0, 6.0);
+    RowView latest = history.row_element(0);
+    TEST_ASSERT(latest.ptr == history.row_element(0).ptr, "Row views should point into the cache");
+    TEST_ASSERT(std::abs(store.Modu(latest) - std::sqrt(77.0)) < EPSILON, "Modu over a row view failed");
+    
+    // Smoothing statistics over the two most recent rows (population std)
+    TrackHistory track(3);
+    track.advance();
+    track.set(FILTER_V, 1.0, 2.0, 3.0);
+    track.advance();
+    track.set(FILTER_V, 4.0, 5.0, 6.0);
+    Vec3 mean = store.Smooth_Mean(track, FILTER_V, 2);
+    Vec3 stdev = store.Smooth_Std(track, FILTER_V, 2);
+    TEST_ASSERT(mean[0] == 2.5 && mean[1] == 3.5 && mean[2] == 4.5, "Smooth mean failed");
+    TEST_ASSERT(std::abs(stdev[0] - 1.5) < EPSILON, "Smooth std failed");
+    
     std::cout << "Vector operations test passed!" << std::endl;
     return true;
 }
 
+// Test ring buffer ordering of BatchVector
+bool test_batch_vector_ring_order() {
+    std::cout << "Running test: BatchVector ring order..." << std::endl;
+    
+    int length = 4;
+    BatchVector vec(length);
+    
+    // Push more rows than the cache can hold so the head wraps around
+    for (int i = 0; i < 6; ++i) {
+        vec.update(1.0 * i, 10.0 * i, 100.0 * i);
+    }
+    
+    TEST_ASSERT(vec.is_initialized(), "BatchVector should be initialized after wrapping");
+    TEST_ASSERT(vec.clock_step == 6, "Clock step should count every update");
+    
+    // row_element(i) is the i-th most recent sample
+    for (int i = 0; i < length; ++i) {
+        RowView row = vec.row_element(i);
+        double expected = 5.0 - i;
+        TEST_ASSERT(row[0] == expected && row[1] == 10.0 * expected && row[2] == 100.0 * expected,
+                    "Row " + std::to_string(i) + " is not in newest-first order");
+    }
+    
+    // data() and col_element() return the same newest-first ordering
+    xt::xarray<double> matrix = vec.data();
+    ColView column = vec.col_element(1);
+    TEST_ASSERT(matrix.shape(0) == 4 && matrix.shape(1) == 3, "Matrix shape mismatch");
+    for (int i = 0; i < length; ++i) {
+        double expected = 5.0 - i;
+        TEST_ASSERT(matrix(i, 0) == expected, "data() is not in newest-first order");
+        TEST_ASSERT(column[i] == 10.0 * expected, "col_element() is not in newest-first order");
+    }
+    
+    std::cout << "BatchVector ring order test passed!" << std::endl;
+    return true;
+}
+
+// Test compile-time length BatchVector against the runtime one
+bool test_fixed_batch_vector() {
+    std::cout << "Running test: FixedBatchVector..." << std::endl;
+    
+    FixedBatchVector<4> fixed;
+    BatchVector dynamic(4);
+    static_assert(FixedBatchVector<4>::length() == 4, "Compile-time length mismatch");
+    
+    for (int i = 0; i < 7; ++i) {
+        fixed.update(0.5 * i, -1.0 * i, 2.0 * i);
+        dynamic.update(0.5 * i, -1.0 * i, 2.0 * i);
+    }
+    
+    TEST_ASSERT(fixed.is_initialized() == dynamic.is_initialized(), "Initialization state mismatch");
+    TEST_ASSERT(fixed.clock_step == dynamic.clock_step, "Clock step mismatch");
+    
+    auto fixed_matrix = fixed.data();
+    xt::xarray<double> dynamic_matrix = dynamic.data();
+    for (std::size_t i = 0; i < 4; ++i) {
+        auto row = fixed.row_element(i);
+        for (std::size_t j = 0; j < 3; ++j) {
+            TEST_ASSERT(fixed_matrix(i, j) == dynamic_matrix(i, j), "data() mismatch");
+            TEST_ASSERT(row[j] == dynamic_matrix(i, j), "row_element() mismatch");
+        }
+        TEST_ASSERT(fixed.col_element(2)[i] == dynamic.col_element(2)[i], "col_element() mismatch");
+    }
+    
+    std::cout << "FixedBatchVector test passed!" << std::endl;
+    return true;
+}
+
+// Test that all channels of the track history share one ring head
+bool test_track_history_shared_head() {
+    std::cout << "Running test: TrackHistory shared head..." << std::endl;
+    
+    TrackHistory history(4);
+    for (int i = 0; i < 6; ++i) {
+        history.advance();
+        history.set(OBSERVE, 1.0 * i, 0.0, 0.0);
+        history.set(FILTER_A, 0.0, 0.0, -1.0 * i);
+        if (i >= 2) {
+            history.set(BASE_VECTOR, 0.0, 2.0 * i, 0.0);
+            history.mark_derived();
+        }
+    }
+    
+    TEST_ASSERT(history.clock_step() == 6 && history.derived_step() == 4, "Step counters mismatch");
+    TEST_ASSERT(!history.is_initialized(), "Derived channels have not filled a full cycle yet");
+    for (int i = 0; i < 4; ++i) {
+        double expected = 5.0 - i;
+        TEST_ASSERT(history.row(OBSERVE, i)[0] == expected, "Observe channel order mismatch");
+        TEST_ASSERT(history.row(FILTER_A, i)[2] == -expected, "Filter_a channel order mismatch");
+        TEST_ASSERT(history.row(BASE_VECTOR, i)[1] == 2.0 * expected, "Base channel order mismatch");
+        TEST_ASSERT(history.col(OBSERVE, 0)[i] == expected, "Column view order mismatch");
+    }
+    
+    // Derived channels of a slot without derived data stay zero
+    history.advance();
+    TEST_ASSERT(history.row(BASE_VECTOR, 0)[1] == 0.0, "Derived channel should be cleared on advance");
+    
+    std::cout << "TrackHistory shared head test passed!" << std::endl;
+    return true;
+}
+
+// Test incremental smoothing statistics against a direct window computation
+bool test_incremental_smooth_stats() {
+    std::cout << "Running test: Incremental smooth stats..." << std::endl;
+    
+    int smooth_window = 5;
+    Feature_Store store(0.04, 5, 21, 10, smooth_window);
+    
+    // Run well past the resync interval on a curved, accelerating trajectory
+    for (int i = 0; i < 3 * SlidingWindowStats::RESYNC_INTERVAL + 17; ++i) {
+        double t = 0.04 * i;
+        store.update(
+            1000.0 * std::cos(t), 800.0 * std::sin(t), 50.0 * t,
+            1000.0 * std::cos(t), 800.0 * std::sin(t), 50.0 * t,
+            -1000.0 * std::sin(t), 800.0 * std::cos(t), 50.0,
+            -1000.0 * std::cos(t), -800.0 * std::sin(t), 0.1 * i
+        );
+        if (i % 7 != 0) {
+            continue;
+        }
+        // Features 9..20 are std/mean of target-frame velocity and acceleration
+        std::vector<double> incremental = store.get_trace_features(smooth_window);
+        Vec3 stdv = store.Smooth_Std(store.track_history, FILTER_V_TARGET, smooth_window);
+        Vec3 meanv = store.Smooth_Mean(store.track_history, FILTER_V_TARGET, smooth_window);
+        Vec3 stda = store.Smooth_Std(store.track_history, FILTER_A_TARGET, smooth_window);
+        Vec3 meana = store.Smooth_Mean(store.track_history, FILTER_A_TARGET, smooth_window);
+        for (int j = 0; j < 3; ++j) {
+            double tol_v = 1e-6 * std::max(1.0, std::abs(meanv[j]));
+            double tol_a = 1e-6 * std::max(1.0, std::abs(meana[j]));
+            TEST_ASSERT(std::abs(incremental[9 + j] - stdv[j]) <= tol_v, "Velocity std drifted");
+            TEST_ASSERT(std::abs(incremental[12 + j] - meanv[j]) <= tol_v, "Velocity mean drifted");
+            TEST_ASSERT(std::abs(incremental[15 + j] - stda[j]) <= tol_a, "Acceleration std drifted");
+            TEST_ASSERT(std::abs(incremental[18 + j] - meana[j]) <= tol_a, "Acceleration mean drifted");
+        }
+    }
+    
+    std::cout << "Incremental smooth stats test passed!" << std::endl;
+    return true;
+}
+
+// Test the fused feature kernel against the individual helper functions
+bool test_fused_trace_features() {
+    std::cout << "Running test: Fused trace features..." << std::endl;
+    
+    Feature_Store store(0.04, 5, 21, 10, 5);
+    for (int i = 0; i < 40; ++i) {
+        double t = 0.1 * i;
+        store.update(
+            100.0 * std::cos(t), 80.0 * std::sin(t), 5.0 * t,
+            100.0 * std::cos(t), 80.0 * std::sin(t), 5.0 * t,
+            -10.0 * std::sin(t), 8.0 * std::cos(t), 0.5,
+            -1.0 * std::cos(t), -0.8 * std::sin(t), 0.01 * i
+        );
+    }
+    
+    // Reference: the original chained computation through the helpers
+    TraceFeatureInput in = store.get_trace_input(5);
+    std::vector<double> expected;
+    const Vec3* blocks[7] = {&in.x_target, &in.v_target, &in.a_target, &in.stdv, &in.meanv, &in.stda, &in.meana};
+    for (const Vec3* block : blocks) {
+        for (int j = 0; j < 3; ++j) {
+            expected.push_back((*block)[j]);
+        }
+    }
+    expected.push_back(Feature_Store::Curvature(in.filter_v, in.filter_a));
+    expected.push_back(Feature_Store::Curvature(in.meanv, in.meana));
+    expected.push_back(Feature_Store::Curvature(in.stdv, in.stda));
+    expected.push_back(Feature_Store::Curvature(in.stdv, in.meana));
+    expected.push_back(Feature_Store::Curvature(in.meanv, in.stda));
+    expected.push_back(Feature_Store::Similarity(in.filter_v, in.filter_a));
+    expected.push_back(Feature_Store::Similarity(in.meanv, in.meana));
+    expected.push_back(Feature_Store::Similarity(in.stdv, in.stda));
+    expected.push_back(Feature_Store::Similarity(in.stdv, in.meana));
+    expected.push_back(Feature_Store::Similarity(in.meanv, in.stda));
+    expected.push_back(Feature_Store::CalAzimuth(in.x_target));
+    expected.push_back(Feature_Store::CalAzimuth(in.v_target));
+    expected.push_back(Feature_Store::CalAzimuth(in.a_target));
+    expected.push_back(Feature_Store::CalElevation(in.x_target));
+    expected.push_back(Feature_Store::CalElevation(in.v_target));
+    expected.push_back(Feature_Store::CalElevation(in.a_target));
+    TEST_ASSERT(expected.size() == TRACE_FEATURE_DIM, "Reference feature count mismatch");
+    
+    // The fused kernel writes into a caller-provided buffer and matches bit for bit
+    double fused[TRACE_FEATURE_DIM];
+    store.get_trace_features(fused, 5);
+    std::vector<double> as_vector = store.get_trace_features(5);
+    for (int i = 0; i < TRACE_FEATURE_DIM; ++i) {
+        TEST_ASSERT(fused[i] == expected[i], "Fused feature " + std::to_string(i) + " differs from reference");
+        TEST_ASSERT(as_vector[i] == fused[i], "Vector overload differs from buffer overload");
+    }
+    
+    std::cout << "Fused trace features test passed!" << std::endl;
+    return true;
+}
+
+// Reference: the original branch-ladder angle implementations
+static double legacy_elevation(
+  RowView row_vector
+)
+{
+  double gdj,h,R;
+  h =row_vector[2];
+  R = sqrt(row_vector[0]*row_vector[0]+row_vector[1]*row_vector[1]);
+  if ((R<EPSILON)&&(R>-EPSILON))
+  {
+    if ((h<EPSILON)&&(h>-EPSILON))
+    {
+      gdj = 0.0;
+    }
+    else
+    {
+      if (h>EPSILON)
+      {
+        gdj = 1500.0/RADTOMIL;
+      }
+      else
+      {
+        gdj = -1500.0/RADTOMIL;
+      }
+    }
+  }
+  else
+  {
+    gdj = atan(h/R);
+  }
+  return gdj;
+}
+
+
+static double legacy_azimuth(
+  RowView row_vector
+)
+{
+  double nAzimuth = 0.0;
+  double x = row_vector[0];
+  double y = row_vector[1];
+  if ((x<EPSILON) && (x>-EPSILON))
+  {
+    if((y<EPSILON)&&(y>-EPSILON))
+    {
+      nAzimuth = 0.0;
+    }
+    else
+    {
+      if(y >0.0)
+      {
+        nAzimuth = 1500.0/RADTOMIL;
+      }
+      else
+      {
+        nAzimuth = 4500.0/RADTOMIL;
+      }
+    }
+  }
+  else
+  {
+    if(x>0.0)
+    {
+      if ((y<EPSILON)&&(y>-EPSILON))
+      {
+        nAzimuth = 0.0;
+      }
+      else
+      {
+        if(y>0.0)
+        {
+          nAzimuth = atan(y/x);
+        }
+        else
+        {
+          nAzimuth = atan(y/x)+6000.0/RADTOMIL;
+        }
+      }
+    }
+    else
+    {
+      if((y<EPSILON)&&(y>-EPSILON))
+      {
+        nAzimuth = 3000.0/RADTOMIL;
+      }
+      else
+      {
+        nAzimuth = atan(y/x)+3000.0/RADTOMIL;
+      }
+    }
+  }
+  return nAzimuth;
+}
+
+// Test the branch-free angles against the original branch ladders
+bool test_branchless_angles() {
+    std::cout << "Running test: Branch-free angles..." << std::endl;
+    
+    // Axis, EPSILON-boundary and general points in every quadrant
+    std::vector<double> coords = {
+        0.0, -0.0, 1e-9, -1e-9, EPSILON, -EPSILON, 2e-7, -2e-7,
+        1e-3, -1e-3, 0.5, -0.5, 1.0, -1.0, 3.7, -3.7, 250.0, -250.0, 1e6, -1e6
+    };
+    double max_fast_error = 0.0;
+    for (double x : coords) {
+        for (double y : coords) {
+            for (double z : coords) {
+                Vec3 row(x, y, z);
+                double azimuth = Feature_Store::CalAzimuth(row);
+                double elevation = Feature_Store::CalElevation(row);
+                TEST_ASSERT(azimuth == legacy_azimuth(row), "Azimuth differs from branch ladder");
+                TEST_ASSERT(elevation == legacy_elevation(row), "Elevation differs from branch ladder");
+                
+                max_fast_error = std::max(max_fast_error, std::fabs(branchless_azimuth(x, y, true) - azimuth));
+                max_fast_error = std::max(max_fast_error, std::fabs(branchless_elevation(x, y, z, true) - elevation));
+            }
+        }
+    }
+    
+    // Dense sweep of the polynomial against atan
+    for (int i = -20000; i <= 20000; ++i) {
+        double t = i / 2000.0;
+        max_fast_error = std::max(max_fast_error, std::fabs(fast_atan_ratio(t, 1.0) - std::atan(t)));
+        max_fast_error = std::max(max_fast_error, std::fabs(fast_atan_ratio(1.0, t == 0.0 ? 1e-300 : t) - std::atan(1.0 / (t == 0.0 ? 1e-300 : t))));
+    }
+    TEST_ASSERT(max_fast_error <= ANGLE_FAST_MAX_ERROR,
+                "Fast angle error " + std::to_string(max_fast_error) + " exceeds bound");
+    
+    std::cout << "Branch-free angles test passed! (fast max error " << max_fast_error << " rad)" << std::endl;
+    return true;
+}
+
+// Test the cross-target batch engine against the single-target kernel
+bool test_batch_feature_engine() {
+    std::cout << "Running test: Batch feature engine (" << BatchFeatureEngine::simd_path() << ")..." << std::endl;
+    
+    // Enough lanes to force a capacity growth and a vector tail
+    const int num_targets = 37;
+    BatchFeatureEngine engine(8);
+    std::vector<TraceFeatureInput> inputs;
+    for (int k = 0; k < num_targets; ++k) {
+        TraceFeatureInput in;
+        double s = 0.37 * k;
+        in.x_target = Vec3(100.0 * std::cos(s), 80.0 * std::sin(s), 5.0 * k - 60.0);
+        in.v_target = Vec3(-10.0 * std::sin(s), 8.0 * std::cos(s), 0.5 * k);
+        in.a_target = Vec3(-std::cos(s), -0.8 * std::sin(s), 0.01 * k);
+        in.filter_v = Vec3(3.0 - k, 0.2 * k, 1.0);
+        in.filter_a = Vec3(0.1, -0.05 * k, 0.3);
+        in.stdv = Vec3(0.5 + 0.01 * k, 0.2, 0.1 * k);
+        in.meanv = Vec3(2.0, -1.0 + 0.1 * k, 0.5);
+        in.stda = Vec3(0.01 * k, 0.03, 0.02);
+        in.meana = Vec3(-0.2, 0.1, 0.05 * k);
+        if (k == 0) {
+            // Degenerate lane: all-zero vectors must stay finite
+            in = TraceFeatureInput();
+        }
+        inputs.push_back(in);
+        TEST_ASSERT(engine.add(in) == k, "Engine lane index mismatch");
+    }
+    TEST_ASSERT(engine.size() == num_targets, "Engine batch size mismatch");
+    
+    std::vector<double> batch(num_targets * TRACE_FEATURE_DIM);
+    engine.compute(batch.data());
+    for (int k = 0; k < num_targets; ++k) {
+        double expected[TRACE_FEATURE_DIM];
+        Feature_Store::compute_trace_features(inputs[k], expected);
+        for (int i = 0; i < TRACE_FEATURE_DIM; ++i) {
+            double got = batch[k * TRACE_FEATURE_DIM + i];
+            TEST_ASSERT(std::isfinite(got), "Batch feature is not finite");
+            // Bitwise equal to the per-target kernel
+            TEST_ASSERT(got == expected[i],
+                        "Batch feature " + std::to_string(i) + " of lane " + std::to_string(k) + " differs");
+        }
+    }
+    
+    // Fast angle mode only changes the six angle features, within the documented bound
+    engine.set_angle_mode(ANGLE_FAST);
+    std::vector<double> fast_batch(num_targets * TRACE_FEATURE_DIM);
+    engine.compute(fast_batch.data());
+    for (int j = 0; j < num_targets * TRACE_FEATURE_DIM; ++j) {
+        double tolerance = (j % TRACE_FEATURE_DIM) >= 31 ? ANGLE_FAST_MAX_ERROR : 0.0;
+        TEST_ASSERT(std::fabs(fast_batch[j] - batch[j]) <= tolerance, "Fast angle mode out of bound");
+    }
+    engine.set_angle_mode(ANGLE_EXACT);
+    
+    // clear() keeps storage and restarts lane numbering
+    engine.clear();
+    TEST_ASSERT(engine.size() == 0, "Engine should be empty after clear");
+    TEST_ASSERT(engine.add(inputs[5]) == 0, "Lane numbering should restart after clear");
+    double single[TRACE_FEATURE_DIM];
+    double expected[TRACE_FEATURE_DIM];
+    engine.compute(single);
+    Feature_Store::compute_trace_features(inputs[5], expected);
+    for (int i = 0; i < TRACE_FEATURE_DIM; ++i) {
+        TEST_ASSERT(single[i] == expected[i], "Single-lane batch differs from kernel");
+    }
+    
+    std::cout << "Batch feature engine test passed!" << std::endl;
+    return true;
+}
+
+// Test the cached target frame against the trigonometric formulation
+bool test_target_frame() {
+    std::cout << "Running test: Target frame..." << std::endl;
+    
+    std::vector<Vec3> bases = {
+        Vec3(3.0, 4.0, 5.0), Vec3(-3.0, 4.0, -5.0), Vec3(-3.0, -4.0, 1.0), Vec3(3.0, -4.0, 0.0),
+        Vec3(0.0, 2.0, 1.0), Vec3(0.0, -2.0, 1.0), Vec3(2.0, 0.0, 1.0), Vec3(-2.0, 0.0, 1.0),
+        Vec3(0.0, 0.0, 1.0), Vec3(0.0, 0.0, -1.0), Vec3(0.0, 0.0, 0.0), Vec3(1e-8, -1e-8, 7.0)
+    };
+    Vec3 real(1.5, -2.5, 0.75);
+    for (const Vec3& base : bases) {
+        // Reference: the trig formulation through CalAzimuth/CalElevation
+        double h = Feature_Store::CalAzimuth(base);
+        double l = Feature_Store::CalElevation(base);
+        Vec3 expected(
+            std::cos(h) * std::cos(l) * real[0] + std::sin(h) * std::cos(l) * real[1] + std::sin(l) * real[2],
+            -std::sin(h) * real[0] + std::cos(h) * real[1],
+            -std::cos(h) * std::sin(l) * real[0] - std::sin(h) * std::sin(l) * real[1] + std::cos(l) * real[2]
+        );
+        TargetFrame frame(base);
+        Vec3 target = frame.to_target(real);
+        Vec3 back = frame.to_real(target);
+        // RADTOMIL is truncated, so the trig reference itself is only accurate to ~1e-12
+        for (int j = 0; j < 3; ++j) {
+            TEST_ASSERT(std::abs(target[j] - expected[j]) < 1e-11, "Target frame rotation mismatch");
+            TEST_ASSERT(std::abs(back[j] - real[j]) < 1e-12, "Target2Real is not the inverse rotation");
+        }
+    }
+    
+    std::cout << "Target frame test passed!" << std::endl;
+    return true;
+}
+
 // 添加序列特征测试
 bool test_sequence_features() {
     std::cout << "Running test: Sequence features..." << std::endl;
@@ -173,6 +634,206 @@ bool test_sequence_features() {
     return true;
 }
 
+// Test lazy sequence features against the eager per-update computation
+bool test_lazy_sequence_features() {
+    std::cout << "Running test: Lazy sequence features..." << std::endl;
+    
+    Feature_Store eager(0.04, 5, 21, 10, 5);
+    Feature_Store lazy(0.04, 5, 21, 10, 5, true);
+    TEST_ASSERT(lazy.is_lazy_sequence(), "Store should be in lazy mode");
+    
+    // Query after irregular gaps, including gaps longer than the sequence
+    std::vector<int> gaps = {8, 1, 1, 3, 25, 10, 4, 1};
+    int step = 0;
+    for (int gap : gaps) {
+        for (int g = 0; g < gap; ++g, ++step) {
+            double t = 0.1 * step;
+            double args[12] = {
+                100.0 * std::cos(t), 80.0 * std::sin(t), 5.0 * t,
+                100.0 * std::cos(t), 80.0 * std::sin(t), 5.0 * t,
+                -10.0 * std::sin(t), 8.0 * std::cos(t), 0.5,
+                -1.0 * std::cos(t), -0.8 * std::sin(t), 0.01 * step
+            };
+            eager.update(args[0], args[1], args[2], args[3], args[4], args[5],
+                         args[6], args[7], args[8], args[9], args[10], args[11]);
+            lazy.update(args[0], args[1], args[2], args[3], args[4], args[5],
+                        args[6], args[7], args[8], args[9], args[10], args[11]);
+        }
+        TEST_ASSERT(lazy.is_sequence_ready() == eager.is_sequence_ready(), "Lazy readiness differs from eager");
+        if (!eager.is_sequence_ready()) {
+            continue;
+        }
+        
+        const auto& expected = eager.get_trace_features_sequence();
+        const auto& actual = lazy.get_trace_features_sequence();
+        TEST_ASSERT(actual.size() == expected.size(), "Lazy sequence length differs from eager");
+        for (size_t k = 0; k < expected.size(); ++k) {
+            for (int i = 0; i < TRACE_FEATURE_DIM; ++i) {
+                // Older entries use the two-pass window stats instead of the incremental ones
+                double tolerance = 1e-6 * std::max(1.0, std::fabs(expected[k][i]));
+                TEST_ASSERT(std::fabs(actual[k][i] - expected[k][i]) <= tolerance,
+                            "Lazy feature " + std::to_string(i) + " of entry " + std::to_string(k) + " differs");
+            }
+        }
+        
+        // A repeated query without new updates reuses the memoized entries
+        const double* first = actual.front().data();
+        const double* last = actual.back().data();
+        const auto& again = lazy.get_trace_features_sequence();
+        TEST_ASSERT(again.front().data() == first && again.back().data() == last,
+                    "Repeated query should not recompute entries");
+    }
+    
+    // The cache must keep the smoothing window of the oldest entry
+    try {
+        Feature_Store too_short(0.04, 5, 12, 10, 5, true);
+        TEST_ASSERT(false, "Should throw when cache_length is too short for lazy mode");
+    } catch (const std::runtime_error&) {
+        // expected
+    }
+    
+    std::cout << "Lazy sequence features test passed!" << std::endl;
+    return true;
+}
+
+// Test the pre-normalized float32 sequence ring
+bool test_normalized_sequence() {
+    std::cout << "Running test: Normalized sequence ring..." << std::endl;
+    
+    std::vector<double> mean(TRACE_FEATURE_DIM), scale(TRACE_FEATURE_DIM);
+    for (int i = 0; i < TRACE_FEATURE_DIM; ++i) {
+        mean[i] = 0.1 * i - 1.0;
+        scale[i] = 0.5 + 0.05 * i;
+    }
+    
+    for (int lazy = 0; lazy < 2; ++lazy) {
+        Feature_Store store(0.04, 5, 21, 10, 5, lazy == 1);
+        for (int step = 0; step < 60; ++step) {
+            double t = 0.1 * step;
+            store.update(
+                100.0 * std::cos(t), 80.0 * std::sin(t), 5.0 * t,
+                100.0 * std::cos(t), 80.0 * std::sin(t), 5.0 * t,
+                -10.0 * std::sin(t), 8.0 * std::cos(t), 0.5,
+                -1.0 * std::cos(t), -0.8 * std::sin(t), 0.01 * step
+            );
+            // Set the parameters mid-stream: existing entries are normalized at once
+            if (step == 7) {
+                store.set_feature_normalization(mean, scale);
+            }
+            if (step < 20 || step % 3 != 0) {
+                continue;
+            }
+            
+            const float* ring = store.get_normalized_sequence();
+            const auto& sequence = store.get_trace_features_sequence();
+            TEST_ASSERT(static_cast<int>(sequence.size()) == store.get_max_sequence_length(), "Sequence should be full");
+            for (size_t k = 0; k < sequence.size(); ++k) {
+                for (int i = 0; i < TRACE_FEATURE_DIM; ++i) {
+                    float expected = static_cast<float>((sequence[k][i] - mean[i]) / scale[i]);
+                    TEST_ASSERT(ring[k * TRACE_FEATURE_DIM + i] == expected,
+                                "Normalized entry " + std::to_string(k) + " feature " + std::to_string(i) + " differs");
+                }
+            }
+        }
+    }
+    
+    // Parameter size is checked
+    Feature_Store store(0.04, 5, 21, 10, 5);
+    try {
+        store.set_feature_normalization(std::vector<double>(3, 0.0), std::vector<double>(3, 1.0));
+        TEST_ASSERT(false, "Should throw on normalization size mismatch");
+    } catch (const std::runtime_error&) {
+        // expected
+    }
+    try {
+        store.get_normalized_sequence();
+        TEST_ASSERT(false, "Should throw when normalization is not set");
+    } catch (const std::runtime_error&) {
+        // expected
+    }
+    
+    std::cout << "Normalized sequence ring test passed!" << std::endl;
+    return true;
+}
+
+// Test bulk ingest against per-measurement updates
+bool test_bulk_update() {
+    std::cout << "Running test: Bulk update..." << std::endl;
+    
+    // Chunk sizes around max_sequence_length exercise the skipped-feature path
+    std::vector<int> chunks = {3, 14, 1, 10, 27, 9};
+    Feature_Store sequential(0.04, 5, 21, 10, 5);
+    Feature_Store bulk(0.04, 5, 21, 10, 5);
+    int step = 0;
+    for (int chunk : chunks) {
+        std::vector<TraceMeasurement> measurements;
+        for (int c = 0; c < chunk; ++c, ++step) {
+            double t = 0.1 * step;
+            TraceMeasurement m = {
+                0,
+                {100.0 * std::cos(t), 80.0 * std::sin(t), 5.0 * t},
+                {100.0 * std::cos(t), 80.0 * std::sin(t), 5.0 * t},
+                {-10.0 * std::sin(t), 8.0 * std::cos(t), 0.5},
+                {-1.0 * std::cos(t), -0.8 * std::sin(t), 0.01 * step}
+            };
+            measurements.push_back(m);
+            sequential.update(m.obs[0], m.obs[1], m.obs[2],
+                              m.filter_p[0], m.filter_p[1], m.filter_p[2],
+                              m.filter_v[0], m.filter_v[1], m.filter_v[2],
+                              m.filter_a[0], m.filter_a[1], m.filter_a[2]);
+        }
+        bulk.update_bulk(measurements.data(), static_cast<int>(measurements.size()));
+        
+        TEST_ASSERT(bulk.is_sequence_ready() == sequential.is_sequence_ready(), "Bulk readiness differs");
+        TEST_ASSERT(bulk.track_history.clock_step() == sequential.track_history.clock_step(), "Bulk clock differs");
+        if (!sequential.is_sequence_ready()) {
+            continue;
+        }
+        const auto& expected = sequential.get_trace_features_sequence();
+        const auto& actual = bulk.get_trace_features_sequence();
+        TEST_ASSERT(actual.size() == expected.size(), "Bulk sequence length differs");
+        for (size_t k = 0; k < expected.size(); ++k) {
+            TEST_ASSERT(actual[k] == expected[k], "Bulk sequence entry " + std::to_string(k) + " differs");
+        }
+    }
+    
+    std::cout << "Bulk update test passed!" << std::endl;
+    return true;
+}
+
+bool test_image_release() {
+    std::cout << "Running test: Image release..." << std::endl;
+    
+    Feature_Store store(0.04, 5, 21, 10, 5);
+    size_t empty_usage = store.memory_usage();
+    std::vector<unsigned char> image_data(10000, 7);
+    
+    // 未识别时释放图像回到未初始化状态
+    store.update_image(image_data);
+    TEST_ASSERT(store.image_bytes() >= image_data.size(), "Image bytes should cover the image");
+    TEST_ASSERT(store.memory_usage() >= empty_usage + image_data.size(), "Memory usage should include the image");
+    size_t freed = store.release_image();
+    TEST_ASSERT(freed >= image_data.size() && store.image_bytes() == 0, "Release should free the image");
+    TEST_ASSERT(!store.is_image_initialized(), "Image without probabilities should be dropped");
+    
+    // 已缓存识别概率时以概率代替图像
+    store.update_image(image_data);
+    store.set_figure_probs({0.25f, 0.75f});
+    store.release_image();
+    TEST_ASSERT(store.is_image_initialized() && !store.has_image_data(), "Probabilities should replace the image");
+    TEST_ASSERT(store.get_figure_probs().size() == 2, "Cached probabilities should be kept");
+    
+    // 新图像使缓存失效，reset清空全部图像状态
+    store.update_image(image_data);
+    TEST_ASSERT(!store.has_figure_probs() && store.has_image_data(), "New image should invalidate cached probabilities");
+    store.set_figure_probs({1.0f});
+    store.reset();
+    TEST_ASSERT(!store.is_image_initialized() && !store.has_figure_probs() && store.image_bytes() == 0, "Reset should clear image state");
+    
+    std::cout << "Image release test passed!" << std::endl;
+    return true;
+}
+
 int main() {
     bool all_passed = true;
     
@@ -181,7 +842,19 @@ int main() {
         all_passed &= test_feature_store_track_updates();
         all_passed &= test_feature_store_image_handling();
         all_passed &= test_feature_store_vector_operations();
+        all_passed &= test_batch_vector_ring_order();
+        all_passed &= test_fixed_batch_vector();
+        all_passed &= test_track_history_shared_head();
+        all_passed &= test_incremental_smooth_stats();
+        all_passed &= test_fused_trace_features();
+        all_passed &= test_target_frame();
+        all_passed &= test_branchless_angles();
+        all_passed &= test_batch_feature_engine();
         all_passed &= test_sequence_features();
+        all_passed &= test_lazy_sequence_features();
+        all_passed &= test_normalized_sequence();
+        all_passed &= test_bulk_update();
+        all_passed &= test_image_release();
         
         std::cout << "\n=== Test Summary ===\n";
         if (all_passed) {
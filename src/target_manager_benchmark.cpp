@@ -0,0 +1,112 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include "../modules/target_manager/target_manager.h"
+
+// 航迹量测写入吞吐的多线程扩展性测试
+// 用法: target_manager_benchmark [最大线程数] [每线程目标数] [每目标更新次数]
+// 第一部分：多个写入线程各自更新自己的目标
+// 第二部分：单个调用线程写入整帧，帧内目标由工作窃取线程池并行更新，目标数取1k/10k/100k，分片数取1与8倍线程数
+
+// 每个线程更新自己的一组目标，返回全部线程完成所用的秒数
+double run_ingest(TargetManager& manager, int threads, int targets_per_thread, int steps, bool use_frames) {
+    for (int target_id = 0; target_id < threads * targets_per_thread; ++target_id) {
+        manager.add_target(target_id);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            std::vector<TraceMeasurement> frame(targets_per_thread);
+            std::vector<TargetHandle> handles(targets_per_thread);
+            for (int k = 0; k < targets_per_thread; ++k) {
+                handles[k] = manager.find_target(t * targets_per_thread + k);
+            }
+            for (int step = 0; step < steps; ++step) {
+                double time = step * 0.04;
+                for (int k = 0; k < targets_per_thread; ++k) {
+                    TraceMeasurement m = {t * targets_per_thread + k, {time, 1.0 * k, 1.0}, {time, 1.0 * k, 1.0},
+                                          {1.0, 0.1, 0.0}, {0.0, 0.0, 0.01}};
+                    frame[k] = m;
+                }
+                if (use_frames) {
+                    manager.update_targets_trace(frame);
+                    continue;
+                }
+                for (int k = 0; k < targets_per_thread; ++k) {
+                    const TraceMeasurement& m = frame[k];
+                    manager.update_target_trace(handles[k],
+                        m.obs[0], m.obs[1], m.obs[2], m.filter_p[0], m.filter_p[1], m.filter_p[2],
+                        m.filter_v[0], m.filter_v[1], m.filter_v[2], m.filter_a[0], m.filter_a[1], m.filter_a[2]);
+                }
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// 一个线程逐帧写入全部目标，返回所用的秒数
+double run_parallel_frames(TargetManager& manager, int num_targets, int frames) {
+    std::vector<TraceMeasurement> frame(num_targets);
+    auto start = std::chrono::steady_clock::now();
+    for (int step = 0; step < frames; ++step) {
+        double time = step * 0.04;
+        for (int target_id = 0; target_id < num_targets; ++target_id) {
+            TraceMeasurement m = {target_id, {time, 0.01 * target_id, 1.0}, {time, 0.01 * target_id, 1.0},
+                                  {1.0, 0.1, 0.0}, {0.0, 0.0, 0.01}};
+            frame[target_id] = m;
+        }
+        manager.update_targets_trace(frame, true);
+    }
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    int max_threads = argc > 1 ? std::atoi(argv[1]) : std::max(1u, std::thread::hardware_concurrency());
+    int targets_per_thread = argc > 2 ? std::atoi(argv[2]) : 256;
+    int steps = argc > 3 ? std::atoi(argv[3]) : 200;
+
+    std::cout << "threads  shards  mode    updates/s" << std::endl;
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        for (int shards : {1, 4 * threads}) {
+            for (bool use_frames : {false, true}) {
+                TargetManager manager(0.04, 5, 21, 10, 5, false, shards);
+                double seconds = run_ingest(manager, threads, targets_per_thread, steps, use_frames);
+                double updates = static_cast<double>(threads) * targets_per_thread * steps;
+                std::cout << std::setw(7) << threads << "  "
+                          << std::setw(6) << manager.shard_count() << "  "
+                          << (use_frames ? "frame " : "single") << "  "
+                          << std::fixed << std::setprecision(0) << updates / seconds << std::endl;
+            }
+        }
+    }
+
+    std::cout << "\ntargets  threads  shards  frame updates/s" << std::endl;
+    for (int num_targets : {1000, 10000, 100000}) {
+        // 前几帧包含目标创建，不计入
+        int frames = std::max(2, 2000000 / num_targets);
+        for (int threads = 1; threads <= max_threads; threads *= 2) {
+            // 单分片（默认配置）时靠分片内的目标块并行
+            for (int shards : {1, 8 * max_threads}) {
+                TargetManager manager(0.04, 5, 21, 10, 5, false, shards);
+                manager.set_parallel_workers(threads);
+                run_parallel_frames(manager, num_targets, 2);
+                double seconds = run_parallel_frames(manager, num_targets, frames);
+                std::cout << std::setw(7) << num_targets << "  "
+                          << std::setw(7) << threads << "  "
+                          << std::setw(6) << manager.shard_count() << "  "
+                          << std::fixed << std::setprecision(0)
+                          << static_cast<double>(num_targets) * frames / seconds << std::endl;
+            }
+        }
+    }
+    return 0;
+}
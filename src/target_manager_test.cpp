@@ -3,7 +3,14 @@
 #include <stdexcept>
 #include <cassert>
 #include "../modules/target_manager/target_manager.h"
+#include "../modules/target_manager/ingest_queue.h"
 #include <fstream>
+#include <cmath>
+#include <algorithm>
+#include <unordered_map>
+#include <thread>
+#include <atomic>
+#include <chrono>
 
 // 简单的测试辅助宏
 #define TEST_ASSERT(condition, message) \
@@ -118,6 +125,792 @@ bool test_error_handling() {
     return true;
 }
 
+// 测试一帧多目标批量更新与逐个更新结果一致
+bool test_batch_frame_update() {
+    std::cout << "Running test: Batch frame update..." << std::endl;
+    
+    const int num_targets = 12;
+    TargetManager batch_manager(0.04, 5, 21);
+    TargetManager scalar_manager(0.04, 5, 21);
+    for (int id = 0; id < num_targets; ++id) {
+        batch_manager.add_target(id);
+        scalar_manager.add_target(id);
+    }
+    
+    std::vector<TraceMeasurement> frame;
+    for (int step = 0; step < 30; ++step) {
+        frame.clear();
+        for (int id = 0; id < num_targets; ++id) {
+            double t = 0.1 * step + 0.5 * id;
+            TraceMeasurement m = {
+                id,
+                {100.0 * std::cos(t), 80.0 * std::sin(t), 5.0 * t},
+                {100.0 * std::cos(t), 80.0 * std::sin(t), 5.0 * t},
+                {-10.0 * std::sin(t), 8.0 * std::cos(t), 0.5},
+                {-1.0 * std::cos(t), -0.8 * std::sin(t), 0.01 * step}
+            };
+            frame.push_back(m);
+        }
+        // 同一目标在帧内重复出现
+        if (step % 7 == 0) {
+            TraceMeasurement extra = frame[3];
+            extra.obs[0] += 1.0;
+            frame.push_back(extra);
+        }
+        batch_manager.update_targets_trace(frame);
+        for (const TraceMeasurement& m : frame) {
+            scalar_manager.update_target_trace(
+                m.target_id,
+                m.obs[0], m.obs[1], m.obs[2],
+                m.filter_p[0], m.filter_p[1], m.filter_p[2],
+                m.filter_v[0], m.filter_v[1], m.filter_v[2],
+                m.filter_a[0], m.filter_a[1], m.filter_a[2]
+            );
+        }
+    }
+    
+    std::vector<int> ids;
+    for (int id = 0; id < num_targets; ++id) {
+        ids.push_back(id);
+        const auto& batch_sequence = batch_manager.get_feature_store(id)->get_trace_features_sequence();
+        const auto& scalar_sequence = scalar_manager.get_feature_store(id)->get_trace_features_sequence();
+        TEST_ASSERT(batch_sequence.size() == scalar_sequence.size(), "Sequence length mismatch");
+        for (size_t s = 0; s < batch_sequence.size(); ++s) {
+            for (int i = 0; i < TRACE_FEATURE_DIM; ++i) {
+                // 批量引擎与单目标内核逐位一致
+                TEST_ASSERT(batch_sequence[s][i] == scalar_sequence[s][i],
+                            "Batch sequence feature differs for target " + std::to_string(id));
+            }
+        }
+    }
+    
+    // 批量读取最新特征
+    std::vector<double> features;
+    batch_manager.compute_trace_features(ids, features);
+    TEST_ASSERT(features.size() == ids.size() * TRACE_FEATURE_DIM, "Batch feature matrix size mismatch");
+    for (int id = 0; id < num_targets; ++id) {
+        std::vector<double> expected = scalar_manager.get_feature_store(id)->get_trace_features(5);
+        for (int i = 0; i < TRACE_FEATURE_DIM; ++i) {
+            TEST_ASSERT(features[id * TRACE_FEATURE_DIM + i] == expected[i],
+                        "Batch latest feature differs for target " + std::to_string(id));
+        }
+    }
+    
+    // 单目标批量回填与逐个更新一致
+    std::vector<TraceMeasurement> backfill;
+    for (int step = 0; step < 25; ++step) {
+        TraceMeasurement m = {0, {1.0 * step, 2.0, 3.0}, {1.0 * step, 2.0, 3.0}, {1.0, 0.1 * step, 0.0}, {0.0, 0.1, 0.01 * step}};
+        backfill.push_back(m);
+    }
+    batch_manager.update_target_trace_bulk(0, backfill.data(), static_cast<int>(backfill.size()));
+    for (const TraceMeasurement& m : backfill) {
+        scalar_manager.update_target_trace(
+            0,
+            m.obs[0], m.obs[1], m.obs[2],
+            m.filter_p[0], m.filter_p[1], m.filter_p[2],
+            m.filter_v[0], m.filter_v[1], m.filter_v[2],
+            m.filter_a[0], m.filter_a[1], m.filter_a[2]
+        );
+    }
+    TEST_ASSERT(batch_manager.get_feature_store(0)->get_trace_features_sequence() ==
+                scalar_manager.get_feature_store(0)->get_trace_features_sequence(),
+                "Bulk backfill sequence differs");
+    
+    // add_missing 时自动添加帧内的新目标
+    frame.resize(2);
+    frame[0].target_id = 100;
+    frame[1].target_id = 100;
+    batch_manager.update_targets_trace(frame, true);
+    TEST_ASSERT(batch_manager.has_target(100), "Frame update should add missing target");
+    TEST_ASSERT(batch_manager.get_feature_store(100)->track_history.clock_step() == 2,
+                "Missing target should receive both measurements");
+    
+    // 帧内有未知目标时整帧拒绝
+    frame.resize(1);
+    frame[0].target_id = num_targets + 1;
+    try {
+        batch_manager.update_targets_trace(frame);
+        TEST_ASSERT(false, "Should throw exception when frame contains non-existent target");
+    } catch (const std::runtime_error&) {
+        // 预期的异常
+    }
+    
+    std::cout << "Batch frame update test passed!" << std::endl;
+    return true;
+}
+
+// 测试只读访问共享分片读锁，可读取已标准化序列的副本
+bool test_shared_visitors() {
+    std::cout << "Running test: Shared visitors..." << std::endl;
+    
+    TargetManager manager(0.04, 5, 21, 4, 3);
+    std::vector<double> mean(TRACE_FEATURE_DIM, 0.0), scale(TRACE_FEATURE_DIM, 1.0);
+    manager.set_feature_normalization(mean, scale);
+    manager.add_target(0);
+    manager.add_target(1);
+    for (int step = 0; step < 30; ++step) {
+        double t = step * 0.04;
+        manager.update_target_trace(0, t, 2 * t, 1, t, 2 * t, 1, 1, 2, 0, 0, 0, 0);
+    }
+    
+    // 两个访问者同时停留在同一分片内，写锁下第二个访问者无法进入
+    std::atomic<int> inside(0);
+    std::atomic<bool> overlapped(false);
+    auto reader = [&](int target_id) {
+        manager.visit_target(target_id, [&](const Feature_Store&) {
+            ++inside;
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+            while (inside.load() < 2 && std::chrono::steady_clock::now() < deadline) {
+                std::this_thread::yield();
+            }
+            if (inside.load() == 2) {
+                overlapped = true;
+            }
+        });
+    };
+    std::thread first(reader, 0);
+    std::thread second(reader, 1);
+    first.join();
+    second.join();
+    TEST_ASSERT(overlapped.load(), "Read-only visitors should share the shard lock");
+    
+    std::vector<float> copied;
+    bool found = manager.visit_target(manager.find_target(0), [&](const Feature_Store& feature_store) {
+        const float* sequence = feature_store.get_normalized_sequence();
+        copied.assign(sequence, sequence + feature_store.get_max_sequence_length() * TRACE_FEATURE_DIM);
+    });
+    TEST_ASSERT(found, "Visitor should find the target");
+    const float* expected = manager.get_feature_store(0)->get_normalized_sequence();
+    TEST_ASSERT(std::equal(copied.begin(), copied.end(), expected), "Const sequence read should match");
+    TEST_ASSERT(!manager.visit_target(TargetHandle(), [](const Feature_Store&) {}), "Invalid handle should not be visited");
+    
+    std::cout << "Shared visitors test passed!" << std::endl;
+    return true;
+}
+
+// 测试稠密句柄与代数失效
+bool test_target_handles() {
+    std::cout << "Running test: Target handles..." << std::endl;
+    
+    TargetManager manager(0.04, 5, 21);
+    TargetHandle a = manager.add_target(7);
+    TargetHandle b = manager.add_target(8);
+    TEST_ASSERT(a.valid() && b.valid() && a.slot != b.slot, "Handles should be valid and distinct");
+    
+    // 重复添加返回同一句柄，查找结果一致
+    TargetHandle again = manager.add_target(7);
+    TEST_ASSERT(again.slot == a.slot && again.generation == a.generation, "Re-adding should return the same handle");
+    TargetHandle found = manager.find_target(8);
+    TEST_ASSERT(found.slot == b.slot && found.generation == b.generation, "find_target should match add_target");
+    TEST_ASSERT(!manager.find_target(9).valid(), "Unknown target should give an invalid handle");
+    TEST_ASSERT(manager.get_feature_store(a) == manager.get_feature_store(7), "Handle and id should resolve to the same store");
+    
+    // 句柄更新与ID更新作用于同一目标
+    manager.update_target_trace(a, 1, 2, 3, 1, 2, 3, 0.1, 0.2, 0.3, 0.01, 0.02, 0.03);
+    TEST_ASSERT(manager.get_feature_store(7)->track_history.clock_step() == 1, "Handle update should reach the target");
+    
+    // 移除后旧句柄失效，槽位复用后也不会指向新目标
+    manager.remove_target(7);
+    TEST_ASSERT(manager.get_feature_store(a) == nullptr, "Handle should be stale after removal");
+    TargetHandle c = manager.add_target(9);
+    TEST_ASSERT(c.slot == a.slot && c.generation != a.generation, "Freed slot should be reused with a new generation");
+    TEST_ASSERT(manager.get_feature_store(a) == nullptr, "Stale handle must not resolve to the reused slot");
+    TEST_ASSERT(manager.get_feature_store(c)->track_history.clock_step() == 0, "Reused slot should hold a fresh target");
+    try {
+        manager.update_target_trace(a, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+        TEST_ASSERT(false, "Should throw on stale handle");
+    } catch (const std::runtime_error&) {
+        // 预期的异常
+    }
+    // 图像写入的句柄版本不抛出异常，失效时返回false且不写入
+    std::vector<unsigned char> image(16, 1);
+    TEST_ASSERT(!manager.update_target_image(a, image), "Stale handle image update should return false");
+    TEST_ASSERT(!manager.update_target_image(TargetHandle(), image), "Default handle image update should return false");
+    TEST_ASSERT(!manager.get_feature_store(c)->is_image_initialized(), "Stale handle must not write the reused slot");
+    TEST_ASSERT(manager.update_target_image(c, image), "Valid handle image update should return true");
+    TEST_ASSERT(manager.get_feature_store(c)->is_image_initialized(), "Image should reach the target");
+    TEST_ASSERT(manager.target_count() == 2, "Target count mismatch");
+    TEST_ASSERT(!manager.get_feature_store(TargetHandle()), "Default handle should not resolve");
+    
+    std::cout << "Target handles test passed!" << std::endl;
+    return true;
+}
+
+// 测试开放寻址ID表：冲突、扩容、后移删除
+bool test_target_id_map() {
+    std::cout << "Running test: Target id map..." << std::endl;
+    
+    TargetIdMap map(4);
+    TEST_ASSERT(map.find(1) == TargetIdMap::NOT_FOUND, "Empty map should not find keys");
+    for (int i = 0; i < 100; ++i) {
+        map.insert(i * 1024, i);   // 低位相同的ID
+    }
+    TEST_ASSERT(map.size() == 100, "Size mismatch after growth");
+    for (int i = 0; i < 100; ++i) {
+        TEST_ASSERT(map.find(i * 1024) == i, "Lookup mismatch after growth");
+    }
+    map.insert(0, 42);
+    TEST_ASSERT(map.find(0) == 42 && map.size() == 100, "Insert should overwrite existing key");
+    TEST_ASSERT(map.erase(0) && !map.erase(0), "Erase should report presence");
+    TEST_ASSERT(map.find(0) == TargetIdMap::NOT_FOUND, "Erased key should be gone");
+    
+    // 随机插入删除，与std::unordered_map对照
+    map.clear();
+    std::unordered_map<int, int> reference;
+    unsigned int state = 12345;
+    for (int step = 0; step < 20000; ++step) {
+        state = state * 1103515245u + 12345u;
+        int key = static_cast<int>((state >> 8) % 512) - 256;
+        if ((state >> 4) & 1) {
+            map.insert(key, step);
+            reference[key] = step;
+        } else {
+            bool erased = map.erase(key);
+            TEST_ASSERT(erased == (reference.erase(key) == 1), "Erase result mismatch");
+        }
+        state = state * 1103515245u + 12345u;
+        int probe = static_cast<int>((state >> 8) % 512) - 256;
+        auto it = reference.find(probe);
+        TEST_ASSERT(map.find(probe) == (it == reference.end() ? TargetIdMap::NOT_FOUND : it->second),
+                    "Lookup mismatch against reference");
+    }
+    TEST_ASSERT(map.size() == reference.size(), "Size mismatch against reference");
+    size_t visited = 0;
+    map.for_each([&](int key, int value) {
+        visited += reference.count(key) && reference[key] == value;
+    });
+    TEST_ASSERT(visited == reference.size(), "for_each should visit every entry once");
+    map.clear();
+    TEST_ASSERT(map.size() == 0 && map.find(reference.begin()->first) == TargetIdMap::NOT_FOUND, "Clear should empty the map");
+    
+    std::cout << "Target id map test passed!" << std::endl;
+    return true;
+}
+
+// 测试Feature_Store对象池：槽位复用同一对象，且复用后状态为全新
+bool test_feature_store_pool() {
+    std::cout << "Running test: Feature store pool..." << std::endl;
+    
+    TargetManager manager(0.04, 5, 21, 4, 3);
+    std::vector<double> mean(TRACE_FEATURE_DIM, 0.0), scale(TRACE_FEATURE_DIM, 1.0);
+    manager.set_feature_normalization(mean, scale);
+    
+    std::vector<Feature_Store*> first;
+    for (int id = 0; id < 200; ++id) {
+        manager.add_target(id);
+        first.push_back(manager.get_feature_store(id));
+    }
+    for (int step = 0; step < 30; ++step) {
+        double t = step * 0.04;
+        manager.update_target_trace(5, t, 2 * t, 1, t, 2 * t, 1, 1, 2, 0, 0, 0, 0);
+    }
+    TEST_ASSERT(manager.get_feature_store(5)->is_track_initialized(), "Target should be initialized");
+    
+    manager.remove_target(5);
+    TargetHandle reused = manager.add_target(1000);
+    Feature_Store* store = manager.get_feature_store(reused);
+    TEST_ASSERT(store == first[5], "Freed slot should reuse the pooled object");
+    TEST_ASSERT(store->track_history.clock_step() == 0, "Reused store should start empty");
+    TEST_ASSERT(!store->is_track_initialized() && !store->is_image_initialized(), "Reused store should be uninitialized");
+    TEST_ASSERT(store->has_feature_normalization(), "Reused store should keep normalization");
+    for (int id = 0; id < 200; ++id) {
+        if (id != 5) {
+            TEST_ASSERT(manager.get_feature_store(id) == first[id], "Pooled objects should not move");
+        }
+    }
+    
+    // 复用对象上的特征与全新对象一致
+    TargetManager fresh_manager(0.04, 5, 21, 4, 3);
+    fresh_manager.set_feature_normalization(mean, scale);
+    fresh_manager.add_target(1000);
+    for (int step = 0; step < 30; ++step) {
+        double t = step * 0.04;
+        manager.update_target_trace(1000, t, t, 3, t, t, 3, 1, 1, 0.5, 0, 0, 0.1);
+        fresh_manager.update_target_trace(1000, t, t, 3, t, t, 3, 1, 1, 0.5, 0, 0, 0.1);
+    }
+    const float* reused_seq = manager.get_feature_store(1000)->get_normalized_sequence();
+    const float* fresh_seq = fresh_manager.get_feature_store(1000)->get_normalized_sequence();
+    for (int i = 0; i < 4 * TRACE_FEATURE_DIM; ++i) {
+        TEST_ASSERT(reused_seq[i] == fresh_seq[i], "Reused store features should match a fresh store");
+    }
+    TEST_ASSERT(manager.target_count() == 200, "Target count mismatch");
+    
+    // 对象构造失败时槽位归还，之后的添加报告同样的错误而不是槽位错乱
+    TargetManager invalid_manager(0.04, 5, 21, 30, 3, true);
+    for (int id = 0; id < 2; ++id) {
+        try {
+            invalid_manager.add_target(id);
+            TEST_ASSERT(false, "Lazy store with a short cache should fail to construct");
+        } catch (const std::runtime_error& e) {
+            TEST_ASSERT(std::string(e.what()).find("cache_length") != std::string::npos,
+                        std::string("Unexpected add_target error: ") + e.what());
+        }
+    }
+    TEST_ASSERT(invalid_manager.target_count() == 0 && !invalid_manager.has_target(0), "Failed add should leave no target");
+    
+    std::cout << "Feature store pool test passed!" << std::endl;
+    return true;
+}
+
+// 并发测试中单个线程的操作序列：帧批量更新、句柄更新与目标移除重建交替
+// 每个线程只操作自己的目标，单线程重放同一序列即得到参考结果
+void run_ingest_ops(TargetManager& manager, int thread, int threads, int ids_per_thread, int steps) {
+    std::vector<TraceMeasurement> frame(ids_per_thread);
+    for (int step = 0; step < steps; ++step) {
+        double t = step * 0.04;
+        for (int k = 0; k < ids_per_thread; ++k) {
+            int target_id = thread + k * threads;
+            TraceMeasurement m = {target_id, {t, 0.5 * target_id, 1.0}, {t, 0.5 * target_id, 1.0},
+                                  {1.0, 0.01 * k, 0.1}, {0.0, 0.001 * step, 0.0}};
+            frame[k] = m;
+        }
+        if (step % 2 == 0) {
+            manager.update_targets_trace(frame, true);
+        } else {
+            for (const TraceMeasurement& m : frame) {
+                TargetHandle handle = manager.find_target(m.target_id);
+                manager.update_target_trace(handle,
+                    m.obs[0], m.obs[1], m.obs[2], m.filter_p[0], m.filter_p[1], m.filter_p[2],
+                    m.filter_v[0], m.filter_v[1], m.filter_v[2], m.filter_a[0], m.filter_a[1], m.filter_a[2]);
+            }
+        }
+        if (step == steps / 2 + 1) {
+            manager.remove_target(thread);  // 下一步是帧批量更新，目标在其中自动重建
+        }
+    }
+}
+
+// 测试分片目标管理器的多线程并发更新
+bool test_concurrent_updates() {
+    std::cout << "Running test: Concurrent sharded updates..." << std::endl;
+    
+    const int threads = 4;
+    const int ids_per_thread = 32;
+    const int steps = 40;
+    TargetManager manager(0.04, 5, 21, 4, 3, false, 8);
+    TargetManager reference(0.04, 5, 21, 4, 3);
+    TEST_ASSERT(manager.shard_count() == 8 && reference.shard_count() == 1, "Shard count mismatch");
+    
+    // 读线程与写线程并发，查询中的目标可能刚被移除
+    std::atomic<bool> done(false);
+    std::atomic<int> reads(0);
+    std::thread reader([&]() {
+        std::vector<double> features;
+        while (!done.load()) {
+            for (int target_id = 0; target_id < threads * ids_per_thread; target_id += 7) {
+                manager.is_target_track_initialized(target_id);
+                try {
+                    manager.compute_trace_features({target_id}, features);
+                } catch (const std::runtime_error&) {
+                    // 目标尚未添加或刚被移除
+                }
+                reads.fetch_add(1);
+            }
+            manager.target_count();
+        }
+    });
+    std::vector<std::thread> writers;
+    for (int t = 0; t < threads; ++t) {
+        writers.emplace_back([&, t]() { run_ingest_ops(manager, t, threads, ids_per_thread, steps); });
+    }
+    for (auto& writer : writers) {
+        writer.join();
+    }
+    done.store(true);
+    reader.join();
+    
+    for (int t = 0; t < threads; ++t) {
+        run_ingest_ops(reference, t, threads, ids_per_thread, steps);
+    }
+    TEST_ASSERT(manager.target_count() == reference.target_count(), "Target count mismatch after concurrent updates");
+    std::vector<int> ids;
+    for (int target_id = 0; target_id < threads * ids_per_thread; ++target_id) {
+        ids.push_back(target_id);
+        TEST_ASSERT(manager.get_feature_store(target_id)->track_history.clock_step() ==
+                    reference.get_feature_store(target_id)->track_history.clock_step(), "Step count mismatch");
+    }
+    std::vector<double> got, expected;
+    manager.compute_trace_features(ids, got);
+    reference.compute_trace_features(ids, expected);
+    TEST_ASSERT(got == expected, "Concurrent updates should match sequential replay");
+    for (int target_id : ids) {
+        auto got_seq = manager.get_feature_store(target_id)->get_trace_features_sequence();
+        auto expected_seq = reference.get_feature_store(target_id)->get_trace_features_sequence();
+        TEST_ASSERT(got_seq == expected_seq, "Sequence features mismatch after concurrent updates");
+    }
+    TEST_ASSERT(reads.load() > 0, "Reader thread should have run");
+    
+    std::cout << "Concurrent sharded updates test passed!" << std::endl;
+    return true;
+}
+
+// 测试无锁写入队列：丢弃计数、成批写入与多生产者并发
+bool test_ingest_queue() {
+    std::cout << "Running test: Ingest queue..." << std::endl;
+    
+    // 容量8，每轮最多取4个
+    TargetManager manager(0.04, 5, 21, 4, 3);
+    IngestQueue queue(manager, 8, 4);
+    for (int step = 0; step < 10; ++step) {
+        TraceMeasurement m = {1, {step * 1.0, 0.0, 0.0}, {step * 1.0, 0.0, 0.0}, {1.0, 0.0, 0.0}, {0.0, 0.0, 0.0}};
+        bool accepted = queue.push_trace(m);
+        TEST_ASSERT(accepted == (step < 8), "Queue should accept up to its capacity");
+    }
+    IngestStats stats = queue.stats();
+    TEST_ASSERT(stats.depth == 8 && stats.enqueued == 8 && stats.dropped == 2, "Queue stats mismatch before drain");
+    TEST_ASSERT(!manager.has_target(1), "Enqueue should not touch the target");
+    TEST_ASSERT(queue.drain() == 4, "Drain should respect the batch size");
+    TEST_ASSERT(manager.get_feature_store(1)->track_history.clock_step() == 4, "Drained measurements should be applied");
+    TEST_ASSERT(queue.push_image(1, std::vector<unsigned char>(16, 7)), "Image should be accepted");
+    queue.flush();
+    stats = queue.stats();
+    TEST_ASSERT(stats.depth == 0 && stats.drained == 9, "Flush should drain everything");
+    TEST_ASSERT(manager.get_feature_store(1)->track_history.clock_step() == 8, "All accepted measurements should be applied");
+    TEST_ASSERT(manager.is_target_image_initialized(1), "Queued image should be applied");
+    TEST_ASSERT(stats.max_latency_us >= stats.mean_latency_us && stats.mean_latency_us > 0.0, "Latency stats should be recorded");
+    
+    // 多个生产者与后台消费线程，结果与顺序写入一致
+    const int producers = 4;
+    const int ids_per_producer = 16;
+    const int steps = 30;
+    TargetManager async_manager(0.04, 5, 21, 4, 3, false, 4);
+    TargetManager reference(0.04, 5, 21, 4, 3);
+    IngestQueue async_queue(async_manager, 64, 16, 10);
+    async_queue.start();
+    auto measurement = [](int target_id, int step) {
+        double t = step * 0.04;
+        TraceMeasurement m = {target_id, {t, 0.1 * target_id, 2.0}, {t, 0.1 * target_id, 2.0},
+                              {1.0, 0.0, 0.01 * step}, {0.0, 0.001, 0.0}};
+        return m;
+    };
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p]() {
+            for (int step = 0; step < steps; ++step) {
+                for (int k = 0; k < ids_per_producer; ++k) {
+                    // 队列满时重试，保证本测试不丢量测
+                    while (!async_queue.push_trace(measurement(p * ids_per_producer + k, step))) {
+                        std::this_thread::yield();
+                    }
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    async_queue.flush();
+    TEST_ASSERT(async_queue.is_running(), "Worker should still be running");
+    async_queue.stop();
+    
+    std::vector<int> ids;
+    for (int target_id = 0; target_id < producers * ids_per_producer; ++target_id) {
+        reference.add_target(target_id);
+        for (int step = 0; step < steps; ++step) {
+            TraceMeasurement m = measurement(target_id, step);
+            reference.update_target_trace(target_id,
+                m.obs[0], m.obs[1], m.obs[2], m.filter_p[0], m.filter_p[1], m.filter_p[2],
+                m.filter_v[0], m.filter_v[1], m.filter_v[2], m.filter_a[0], m.filter_a[1], m.filter_a[2]);
+        }
+        ids.push_back(target_id);
+    }
+    std::vector<double> got, expected;
+    async_manager.compute_trace_features(ids, got);
+    reference.compute_trace_features(ids, expected);
+    TEST_ASSERT(got == expected, "Queued updates should match sequential updates");
+    stats = async_queue.stats();
+    TEST_ASSERT(stats.drained == stats.enqueued && stats.depth == 0, "Every accepted measurement should be drained");
+    TEST_ASSERT(stats.enqueued == static_cast<std::uint64_t>(producers * ids_per_producer * steps), "Enqueued count mismatch");
+    TEST_ASSERT(stats.failed == 0, "No measurement should fail");
+    
+    // 写入出错时后台线程继续运行，失败计数，flush照常返回
+    TargetManager invalid_manager(0.04, 5, 21, 30, 3, true);   // 对象无法构造，添加目标总是失败
+    IngestQueue failing_queue(invalid_manager, 16, 4, 10);
+    failing_queue.start();
+    for (int step = 0; step < 6; ++step) {
+        TEST_ASSERT(failing_queue.push_trace(measurement(step % 2, step)), "Trace should be accepted");
+    }
+    TEST_ASSERT(failing_queue.push_image(3, std::vector<unsigned char>(16, 7)), "Image should be accepted");
+    failing_queue.flush();
+    TEST_ASSERT(failing_queue.is_running(), "Worker should survive failed updates");
+    stats = failing_queue.stats();
+    TEST_ASSERT(stats.drained == 7 && stats.failed == 7, "Failed measurements should be drained and counted");
+    failing_queue.stop();
+    
+    std::cout << "Ingest queue test passed!" << std::endl;
+    return true;
+}
+
+// 测试工作窃取线程池与并行帧更新
+bool test_parallel_frame_update() {
+    std::cout << "Running test: Parallel frame update..." << std::endl;
+    
+    // 每个任务恰好执行一次；任务耗时不均时由其他线程窃取
+    WorkStealingPool pool(4);
+    std::vector<std::atomic<int>> hits(97);
+    for (auto& hit : hits) {
+        hit.store(0);
+    }
+    pool.run(97, [&](int i) {
+        if (i < 24) {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+        hits[i].fetch_add(1);
+    });
+    for (auto& hit : hits) {
+        TEST_ASSERT(hit.load() == 1, "Each task should run exactly once");
+    }
+    try {
+        pool.run(8, [](int i) {
+            if (i == 5) {
+                throw std::runtime_error("task failed");
+            }
+        });
+        TEST_ASSERT(false, "Task exception should be rethrown");
+    } catch (const std::runtime_error&) {
+        // 预期的异常
+    }
+    
+    // 并行帧更新与串行结果逐位一致，帧内含重复目标与新目标
+    // 单分片时目标按块并行，块之间的边界上也有重复目标
+    TargetManager parallel(0.04, 5, 21, 4, 3, false, 16);
+    parallel.set_parallel_workers(4);
+    TEST_ASSERT(parallel.parallel_workers() == 4, "Worker count mismatch");
+    TargetManager single_shard(0.04, 5, 21, 4, 3);
+    single_shard.set_parallel_workers(4);
+    TargetManager serial(0.04, 5, 21, 4, 3);
+    const int num_targets = 700;
+    for (int step = 0; step < 30; ++step) {
+        std::vector<TraceMeasurement> frame;
+        for (int target_id = 0; target_id < num_targets; ++target_id) {
+            double t = step * 0.04;
+            TraceMeasurement m = {target_id, {t, 0.2 * target_id, 1.0}, {t, 0.2 * target_id, 1.0},
+                                  {1.0, 0.01 * step, 0.0}, {0.0, 0.0, 0.001 * target_id}};
+            frame.push_back(m);
+            if (target_id % 17 == 0) {
+                m.filter_v[2] = 0.5;   // 同一目标在帧内再出现一次
+                frame.push_back(m);
+            }
+        }
+        parallel.update_targets_trace(frame, true);
+        single_shard.update_targets_trace(frame, true);
+        serial.update_targets_trace(frame, true);
+    }
+    std::vector<int> ids;
+    for (int target_id = 0; target_id < num_targets; ++target_id) {
+        ids.push_back(target_id);
+        TEST_ASSERT(parallel.get_feature_store(target_id)->get_trace_features_sequence() ==
+                    serial.get_feature_store(target_id)->get_trace_features_sequence(), "Parallel sequence mismatch");
+        TEST_ASSERT(single_shard.get_feature_store(target_id)->get_trace_features_sequence() ==
+                    serial.get_feature_store(target_id)->get_trace_features_sequence(), "Chunked sequence mismatch");
+    }
+    std::vector<double> got, expected, chunked;
+    parallel.compute_trace_features(ids, got);
+    single_shard.compute_trace_features(ids, chunked);
+    serial.compute_trace_features(ids, expected);
+    TEST_ASSERT(got == expected, "Parallel frame update should match serial update");
+    TEST_ASSERT(chunked == expected, "Chunked frame update should match serial update");
+    
+    std::vector<TraceMeasurement> bad_frame(2);
+    bad_frame[0].target_id = 1;
+    bad_frame[1].target_id = num_targets + 5;
+    try {
+        parallel.update_targets_trace(bad_frame);
+        TEST_ASSERT(false, "Should throw exception when frame contains non-existent target");
+    } catch (const std::runtime_error&) {
+        // 预期的异常
+    }
+    TEST_ASSERT(parallel.get_feature_store(1)->track_history.clock_step() == 30, "Rejected frame should not update targets");
+    
+    std::cout << "Parallel frame update test passed!" << std::endl;
+    return true;
+}
+
+// 测试分层时间轮与空闲超时、目标数上限的自动移除
+bool test_target_eviction() {
+    std::cout << "Running test: Target eviction..." << std::endl;
+    
+    // 时间轮：跨层迁移后仍在到期时刻准确触发
+    TimingWheel wheel;
+    std::vector<unsigned long long> deadlines = {1, 5, 63, 64, 65, 100, 4095, 4096, 5000, 262144, 300000};
+    for (int id = 0; id < static_cast<int>(deadlines.size()); ++id) {
+        wheel.schedule(id, deadlines[id]);
+    }
+    wheel.schedule(20, 7);
+    wheel.cancel(20);
+    TEST_ASSERT(wheel.size() == static_cast<int>(deadlines.size()), "Wheel size mismatch");
+    std::vector<unsigned long long> fired(deadlines.size(), 0);
+    for (unsigned long long now = 1; now <= 300000; ++now) {
+        wheel.advance(now, [&](int id) { fired[id] = now; });
+    }
+    for (size_t id = 0; id < deadlines.size(); ++id) {
+        TEST_ASSERT(fired[id] == deadlines[id], "Timer should fire exactly at its deadline");
+    }
+    TEST_ASSERT(wheel.size() == 0 && !wheel.is_scheduled(20), "Wheel should be empty");
+    
+    // 空闲超时：有更新的目标保留，其余在时限后移除并回调
+    TargetManager manager(0.04, 5, 21, 4, 3, false, 4);
+    std::vector<std::pair<int, EvictionReason>> evicted;
+    manager.set_eviction_policy(10, 0, [&](int target_id, EvictionReason reason) {
+        evicted.push_back({target_id, reason});
+    });
+    for (int target_id = 0; target_id < 20; ++target_id) {
+        manager.add_target(target_id);
+    }
+    for (int step = 0; step < 25; ++step) {
+        manager.tick();
+        manager.update_target_trace(3, step, 0, 0, step, 0, 0, 1, 0, 0, 0, 0, 0);
+        std::vector<TraceMeasurement> frame(1);
+        frame[0].target_id = 4;
+        manager.update_targets_trace(frame);
+        if (step < 9) {
+            TEST_ASSERT(manager.target_count() == 20, "No target should expire before its TTL");
+        }
+    }
+    TEST_ASSERT(manager.target_count() == 2 && manager.has_target(3) && manager.has_target(4), "Idle targets should be evicted");
+    TEST_ASSERT(evicted.size() == 18 && evicted[0].second == EVICT_IDLE, "Eviction callback should report idle targets");
+    
+    // 目标数上限：移除最久未更新的目标
+    TargetManager capped(0.04, 5, 21, 4, 3);
+    evicted.clear();
+    capped.set_eviction_policy(0, 3, [&](int target_id, EvictionReason reason) {
+        evicted.push_back({target_id, reason});
+    });
+    capped.add_target(1);
+    capped.add_target(2);
+    capped.add_target(3);
+    capped.update_target_trace(1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    TargetHandle fourth = capped.add_target(4);
+    TEST_ASSERT(capped.target_count() == 3 && !capped.has_target(2), "Least recently updated target should be evicted");
+    TEST_ASSERT(evicted.size() == 1 && evicted[0].first == 2 && evicted[0].second == EVICT_CAPACITY, "Capacity eviction callback mismatch");
+    TEST_ASSERT(capped.get_feature_store(fourth) != nullptr, "New target should survive the cap");
+    
+    // 帧内新目标超过上限时，帧处理完成后再移除
+    std::vector<TraceMeasurement> frame(5);
+    for (int k = 0; k < 5; ++k) {
+        frame[k].target_id = 10 + k;
+    }
+    capped.update_targets_trace(frame, true);
+    TEST_ASSERT(capped.target_count() == 3, "Frame update should respect the cap");
+    for (int k = 2; k < 5; ++k) {
+        TEST_ASSERT(capped.get_feature_store(10 + k)->track_history.clock_step() == 1, "Newest frame targets should be kept");
+    }
+    
+    std::cout << "Target eviction test passed!" << std::endl;
+    return true;
+}
+
+bool test_image_budget() {
+    std::cout << "Running test: Image budget..." << std::endl;
+    
+    const size_t image_size = 1000;
+    std::vector<unsigned char> image_data(image_size, 1);
+    TargetManager manager(0.04, 5, 21, 4, 3, false, 2);
+    for (int target_id = 0; target_id < 10; ++target_id) {
+        manager.add_target(target_id);
+        manager.update_target_image(target_id, image_data);
+    }
+    ImageMemoryStats stats = manager.image_memory_stats();
+    TEST_ASSERT(stats.images == 10 && stats.image_bytes == 10 * image_size, "Unlimited budget should keep every image");
+    TEST_ASSERT(manager.target_memory_bytes(0) >= image_size, "Target memory should include its image");
+    TEST_ASSERT(manager.target_memory_bytes(100) == 0, "Missing target should use no memory");
+    TEST_ASSERT(manager.total_memory_bytes() >= 10 * image_size, "Total memory should include all images");
+    
+    // 目标0已识别，超出上限后以概率代替图像；其余未识别的目标丢弃图像
+    manager.modify_target(0, [](Feature_Store& feature_store) { feature_store.set_figure_probs({0.5f, 0.5f}); });
+    manager.set_image_budget(4 * image_size);
+    stats = manager.image_memory_stats();
+    TEST_ASSERT(stats.image_bytes <= 4 * image_size && stats.images <= 4, "Budget should bound image memory");
+    TEST_ASSERT(stats.replaced == 1 && stats.dropped == static_cast<unsigned long long>(10 - stats.images - 1), "Release counters mismatch");
+    TEST_ASSERT(manager.is_target_image_initialized(0), "Recognized target should keep its probabilities");
+    TEST_ASSERT(manager.get_feature_store(0)->image_bytes() == 0, "Recognized target image should be released");
+    
+    // 按最近写入顺序保留：连续写入同一分片的目标时，先写入的先被释放
+    std::vector<int> same_shard;
+    for (int target_id = 100; same_shard.size() < 3; ++target_id) {
+        if (manager.target_shard(target_id) == 0) {
+            same_shard.push_back(target_id);
+            manager.add_target(target_id);
+        }
+    }
+    manager.set_image_budget(2 * 2 * image_size);
+    for (int target_id : same_shard) {
+        manager.update_target_image(target_id, image_data);
+    }
+    TEST_ASSERT(!manager.is_target_image_initialized(same_shard[0]), "Oldest image should be dropped first");
+    TEST_ASSERT(manager.is_target_image_initialized(same_shard[1]) && manager.is_target_image_initialized(same_shard[2]),
+                "Newest images should be kept");
+    
+    // 单张图像超出分片上限时仍保留刚写入的图像
+    std::vector<unsigned char> large_image(10 * image_size, 2);
+    manager.update_target_image(same_shard[0], large_image);
+    TEST_ASSERT(manager.get_feature_store(same_shard[0])->has_image_data(), "Latest image should always be kept");
+    
+    // 移除目标后释放其图像
+    size_t before = manager.image_memory_stats().image_bytes;
+    manager.remove_target(same_shard[0]);
+    TEST_ASSERT(manager.image_memory_stats().image_bytes + large_image.size() <= before, "Removed target should release its image");
+    
+    // 记账与各目标实际持有的图像一致
+    size_t held = 0;
+    int images = 0;
+    for (int target_id = 0; target_id < 200; ++target_id) {
+        Feature_Store* feature_store = manager.get_feature_store(target_id);
+        if (feature_store && feature_store->has_image_data()) {
+            held += feature_store->image_bytes();
+            ++images;
+        }
+    }
+    stats = manager.image_memory_stats();
+    TEST_ASSERT(stats.image_bytes == held && stats.images == images, "Image accounting should match held images");
+    
+    std::cout << "Image budget test passed!" << std::endl;
+    return true;
+}
+
+bool test_shared_image_ingest() {
+    std::cout << "Running test: Shared image ingest..." << std::endl;
+    
+    TargetManager manager(0.04, 5, 21, 4, 3, false, 2);
+    ImageBuffer frame = std::make_shared<const std::vector<unsigned char>>(5000, 3);
+    
+    // 同步写入：多个目标共享同一帧图像
+    manager.add_target(1);
+    manager.add_target(2);
+    manager.update_target_image(1, frame);
+    manager.update_target_image(manager.find_target(2), frame);
+    TEST_ASSERT(manager.get_feature_store(1)->get_image_buffer().get() == frame.get(), "Target should share the image buffer");
+    TEST_ASSERT(manager.get_feature_store(2)->get_image_buffer().get() == frame.get(), "Handle path should share the image buffer");
+    TEST_ASSERT(frame.use_count() == 3, "Buffer should be referenced by both targets");
+    
+    // 异步写入：队列中传递的是同一份缓冲区
+    IngestQueue queue(manager, 64, 16);
+    ImageBuffer next = std::make_shared<const std::vector<unsigned char>>(6000, 4);
+    TEST_ASSERT(queue.push_image(3, next), "Shared image should be queued");
+    std::vector<unsigned char> owned(7000, 5);
+    const unsigned char* owned_bytes = owned.data();
+    TEST_ASSERT(queue.push_image(4, std::move(owned)), "Owned image should be queued");
+    queue.flush();
+    TEST_ASSERT(manager.get_feature_store(3)->get_image_buffer().get() == next.get(), "Queued image should not be copied");
+    TEST_ASSERT(manager.get_feature_store(4)->get_image_data().data() == owned_bytes, "Moved image should not be copied");
+    
+    // 移除目标后释放引用
+    manager.remove_target(1);
+    manager.remove_target(2);
+    TEST_ASSERT(frame.use_count() == 1, "Removed targets should release the buffer");
+    
+    bool threw = false;
+    try {
+        manager.update_target_image(3, ImageBuffer());
+    } catch (const std::runtime_error&) {
+        threw = true;
+    }
+    TEST_ASSERT(threw, "Empty image buffer should be rejected");
+    
+    std::cout << "Shared image ingest test passed!" << std::endl;
+    return true;
+}
+
 int main() {
     bool all_passed = true;
     
@@ -125,6 +918,17 @@ int main() {
         all_passed &= test_target_manager_basic();
         all_passed &= test_target_data_updates();
         all_passed &= test_error_handling();
+        all_passed &= test_batch_frame_update();
+        all_passed &= test_shared_visitors();
+        all_passed &= test_target_handles();
+        all_passed &= test_target_id_map();
+        all_passed &= test_feature_store_pool();
+        all_passed &= test_concurrent_updates();
+        all_passed &= test_ingest_queue();
+        all_passed &= test_parallel_frame_update();
+        all_passed &= test_target_eviction();
+        all_passed &= test_image_budget();
+        all_passed &= test_shared_image_ingest();
         
         std::cout << "\n=== Test Summary ===\n";
         if (all_passed) {